@@ -7,6 +7,8 @@
 
 #include <string>
 #include <map>
+#include <charconv>
+#include <cstdio>
 
 using namespace std;
 
@@ -17,4 +19,29 @@ namespace args_parser_constants {
 
 void parseArguments(map<string, string>& argsMap, int argc, char* argv[]);
 
+// Число целиком из text, без пробелов и хвоста; отрицательное в беззнаковый тип - ошибка
+template <typename T>
+bool parseNumber(const string& text, T& value) {
+    const char* end = text.data() + text.size();
+    auto result = from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == errc() && result.ptr == end;
+}
+
+// Числовой флаг name: без флага value не меняется (в нём значение по умолчанию),
+// иначе при ошибке разбора - "Incorrect value for <name>" в stderr и false
+template <typename T>
+bool parseNumericArgument(map<string, string>& argsMap, const string& name, T& value) {
+    const string& text = argsMap[name];
+    if (text.empty()) {
+        return true;
+    }
+    T parsed;
+    if (!parseNumber(text, parsed)) {
+        fprintf(stderr, "Incorrect value for %s\n", name.c_str());
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
 #endif //TESTPROJECT_ARGS_PARSER_H
\ No newline at end of file
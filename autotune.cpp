@@ -0,0 +1,287 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "autotune.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+// границы классов размеров и характерный размер каждого - середина класса в логарифмах
+static constexpr size_t sizeClassBounds[] = {1 << 20, 16 << 20};
+static constexpr size_t sizeClassSamples[] = {256 << 10, 4 << 20, 64 << 20};
+static constexpr int sizeClassesTotal = sizeof(sizeClassSamples) / sizeof(sizeClassSamples[0]);
+
+static constexpr int warmupRuns = 1;
+static constexpr int measuredRuns = 5;
+static constexpr int sampleWidth = 4096;
+
+static const char* cacheHeader = "HOST;CPUS;SIZE_CLASS;BACKEND;THREADS;SCHEDULE_KIND;CHUNK_SIZE;GBPS";
+
+// кэш не удалось записать - до конца процесса --retune больше не измеряет:
+// замеры всё равно потерялись бы, а пакетный режим и сервер платили бы за них на каждом файле
+static atomic<bool> isSaveFailed = false;
+
+static string defaultCachePath() {
+    const char* cacheHome = getenv("XDG_CACHE_HOME");
+    if (cacheHome != nullptr && cacheHome[0] != 0) {
+        return string(cacheHome) + "/contrast_autotune.csv";
+    }
+    const char* home = getenv("HOME");
+    if (home != nullptr && home[0] != 0) {
+        return string(home) + "/.cache/contrast_autotune.csv";
+    }
+    return "contrast_autotune.csv";
+}
+
+static int hardwareThreads() {
+    return max(int(thread::hardware_concurrency()), 1);
+}
+
+static vector<string> splitLine(const string& line) {
+    vector<string> parts;
+    stringstream stream(line);
+    string part;
+    while (getline(stream, part, ';')) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+Autotuner::Autotuner(const string& cache_path) : path(cache_path.empty() ? defaultCachePath() : cache_path) {
+    char name[256] = {0};
+    if (gethostname(name, sizeof(name) - 1) != 0) {
+        strcpy(name, "localhost");
+    }
+    host = name;
+    load();
+}
+
+int Autotuner::sizeClassesCount() noexcept {
+    return sizeClassesTotal;
+}
+
+int Autotuner::sizeClass(size_t data_size) noexcept {
+    int size_class = 0;
+    for (size_t bound : sizeClassBounds) {
+        if (data_size >= bound) {
+            size_class++;
+        }
+    }
+    return size_class;
+}
+
+size_t Autotuner::sizeClassSample(int size_class) noexcept {
+    return sizeClassSamples[size_class];
+}
+
+// без замеров: все ядра на пуле threads со static - разумно почти везде
+static TunedConfig heuristicConfig() {
+    TunedConfig config;
+    config.backend = "threads";
+    config.options.threadsCount = hardwareThreads();
+    config.options.scheduleKind = "static";
+    config.options.chunkSize = 0;
+    return config;
+}
+
+TunedConfig Autotuner::configFor(size_t data_size, int max_threads, bool retune) {
+    int size_class = sizeClass(data_size);
+    if (retune && !isSaveFailed) {
+        fprintf(stderr, "Autotuning for images around %zu KB, results go to %s\n",
+                sizeClassSample(size_class) >> 10, path.c_str());
+        configs[size_class] = tune(size_class);
+        save();
+    }
+
+    auto cached = configs.find(size_class);
+    TunedConfig config = cached != configs.end() ? cached->second : heuristicConfig();
+    config.options.threadsCount = min(config.options.threadsCount, max(max_threads, 1));
+    return config;
+}
+
+vector<TunedConfig> Autotuner::tuneAll() {
+    vector<TunedConfig> results;
+    for (int size_class = 0; size_class < sizeClassesTotal; size_class++) {
+        configs[size_class] = tune(size_class);
+        results.push_back(configs[size_class]);
+    }
+    save();
+    return results;
+}
+
+// Синтетическое P5 того же вида, что гауссово изображение contrast_bench:
+// его действительно надо растягивать, так что замеряется весь путь с remap
+static void generateSample(PNMPicture& picture, size_t size) {
+    picture.format = 5;
+    picture.width = sampleWidth;
+    picture.height = int(size / sampleWidth);
+    picture.colors = 255;
+    picture.channelsCount = 1;
+    picture.bytesPerSample = 1;
+    picture.data_size = size_t(picture.width) * picture.height;
+    picture.data.resize(picture.data_size);
+
+    mt19937 generator(42);
+    normal_distribution<float> gaussian(120, 25);
+    for (size_t i = 0; i < picture.data_size; i++) {
+        picture.data[i] = uchar(clamp(int(gaussian(generator)), 0, 255));
+    }
+}
+
+static vector<TunedConfig> candidates() {
+    vector<TunedConfig> list;
+    list.push_back({"simd", BackendOptions(), 0});
+
+    const int threadsLimit = hardwareThreads();
+    vector<int> threadsCounts;
+    for (int threads = 2; threads < threadsLimit; threads *= 2) {
+        threadsCounts.push_back(threads);
+    }
+    if (threadsLimit > 1) {
+        threadsCounts.push_back(threadsLimit);
+    }
+
+    // у threads кусок в байтах, у omp - в блоках по 64 КБ
+    const vector<pair<string, int>> threadsSchedules = {{"static", 0}, {"dynamic", 65536}, {"guided", 65536}};
+    const vector<pair<string, int>> ompSchedules = {{"static", 0}, {"dynamic", 1}, {"guided", 1}};
+    for (int threads : threadsCounts) {
+        for (const auto& [backend, schedules] : {make_pair("threads", threadsSchedules), make_pair("omp", ompSchedules)}) {
+            for (const auto& [kind, chunk] : schedules) {
+                TunedConfig config;
+                config.backend = backend;
+                config.options.threadsCount = threads;
+                config.options.scheduleKind = kind;
+                config.options.chunkSize = chunk;
+                list.push_back(config);
+            }
+        }
+    }
+
+    const ContrastBackend* cuda = findBackend("cuda");
+    if (cuda != nullptr && cuda->isAvailable()) {
+        list.push_back({"cuda", BackendOptions(), 0});
+    }
+    return list;
+}
+
+TunedConfig Autotuner::tune(int size_class) const {
+    PNMPicture picture;
+    generateSample(picture, sizeClassSample(size_class));
+    const vector<uchar> original(picture.data.begin(), picture.data.end());
+
+    TunedConfig best;
+    for (TunedConfig& candidate : candidates()) {
+        const ContrastBackend* backend = findBackend(candidate.backend);
+
+        vector<double> times;
+        for (int run = 0; run < warmupRuns + measuredRuns; run++) {
+            // растяжение идёт на месте - каждый прогон с исходного тела
+            memcpy(picture.data.data(), original.data(), original.size());
+
+            auto start = chrono::steady_clock::now();
+            backend->modify(picture, 0.00390625f, candidate.options);
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (run >= warmupRuns) {
+                times.push_back(elapsed);
+            }
+        }
+
+        sort(times.begin(), times.end());
+        double median = max(times[times.size() / 2], 1e-9);
+        candidate.gbps = double(picture.data_size) / median / 1e9;
+        if (candidate.gbps > best.gbps) {
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void Autotuner::load() {
+    ifstream file(path);
+    if (!file.is_open()) {
+        return;
+    }
+
+    const string cpus = to_string(hardwareThreads());
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line == cacheHeader) {
+            continue;
+        }
+        vector<string> parts = splitLine(line);
+        if (parts.size() != 8) {
+            continue;
+        }
+        if (parts[0] != host || parts[1] != cpus) {
+            otherLines.push_back(line);
+            continue;
+        }
+
+        try {
+            int size_class = stoi(parts[2]);
+            const ContrastBackend* backend = findBackend(parts[3]);
+            // бэкенда может не быть в этой сборке - тогда класс настроится заново
+            if (size_class < 0 || size_class >= sizeClassesTotal || backend == nullptr || !backend->isAvailable() ||
+                !ThreadPool::isKnownSchedule(parts[5])) {
+                continue;
+            }
+            TunedConfig config;
+            config.backend = parts[3];
+            config.options.threadsCount = max(stoi(parts[4]), 1);
+            config.options.scheduleKind = parts[5];
+            config.options.chunkSize = stoi(parts[6]);
+            config.gbps = stod(parts[7]);
+            configs[size_class] = config;
+        } catch (exception&) {
+            // испорченная строка - как будто её нет
+        }
+    }
+}
+
+// пишем во временный файл и переименовываем - параллельный запуск
+// не прочитает наполовину записанный кэш
+void Autotuner::save() const {
+    error_code error;
+    filesystem::path cachePath(path);
+    if (cachePath.has_parent_path()) {
+        filesystem::create_directories(cachePath.parent_path(), error);
+    }
+
+    const string temporaryPath = path + ".tmp" + to_string(getpid());
+    {
+        ofstream file(temporaryPath, ios::trunc);
+        if (!file.is_open()) {
+            fprintf(stderr, "Error while trying to write autotune cache %s\n", path.c_str());
+            isSaveFailed = true;
+            return;
+        }
+        file << cacheHeader << endl;
+        for (const auto& line : otherLines) {
+            file << line << endl;
+        }
+        const string cpus = to_string(hardwareThreads());
+        for (const auto& [size_class, config] : configs) {
+            file << host << ";" << cpus << ";" << size_class << ";" << config.backend << ";"
+                 << config.options.threadsCount << ";" << config.options.scheduleKind << ";"
+                 << config.options.chunkSize << ";" << config.gbps << endl;
+        }
+    }
+    filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        filesystem::remove(temporaryPath, error);
+        fprintf(stderr, "Error while trying to write autotune cache %s\n", path.c_str());
+        isSaveFailed = true;
+    }
+}
@@ -0,0 +1,64 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_AUTOTUNE_H
+#define TESTPROJECT_AUTOTUNE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "backend.h"
+
+using namespace std;
+
+// выигравшая конфигурация для одного класса размеров
+struct TunedConfig {
+    string backend;
+    BackendOptions options;
+    double gbps = 0;
+};
+
+// Подбор бэкенда, числа потоков, расписания и куска под машину.
+// Тела делятся на классы размеров, для каждого класса кандидаты прогоняются
+// на синтетическом изображении характерного размера, победитель - по медиане.
+// Результаты лежат в небольшом CSV-кэше; строки каждой машины (имя хоста
+// и число процессоров) хранятся отдельно, так что один кэш можно держать
+// в общем домашнем каталоге
+class Autotuner {
+public:
+    // cache_path пустой - путь по умолчанию: $XDG_CACHE_HOME или ~/.cache
+    explicit Autotuner(const string& cache_path = "");
+
+    // конфигурация для тела из data_size байт: из кэша, а если её там нет - без замеров,
+    // все ядра на бэкенде threads со static. Замеры идут только при retune = true
+    // (и tuneAll) и сохраняются; после неудачной записи кэша процесс больше не измеряет.
+    // Кандидаты перебираются до всех процессоров машины, max_threads
+    // ограничивает потоки уже найденной конфигурации
+    TunedConfig configFor(size_t data_size, int max_threads, bool retune);
+
+    // измеряет все классы размеров заново и сохраняет кэш
+    vector<TunedConfig> tuneAll();
+
+    const string& cachePath() const noexcept { return path; }
+
+    static int sizeClassesCount() noexcept;
+    // класс размеров для тела из data_size байт
+    static int sizeClass(size_t data_size) noexcept;
+    // характерный размер тела для класса - на нём идут замеры
+    static size_t sizeClassSample(int size_class) noexcept;
+
+private:
+    TunedConfig tune(int size_class) const;
+    void load();
+    void save() const;
+
+    string path;
+    string host;
+    // класс размеров -> победитель на этой машине
+    map<int, TunedConfig> configs;
+    // строки кэша других машин - переписываются как есть
+    vector<string> otherLines;
+};
+
+#endif //TESTPROJECT_AUTOTUNE_H
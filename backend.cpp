@@ -0,0 +1,58 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "backend.h"
+#include <omp.h>
+
+using namespace std;
+
+static bool alwaysAvailable() {
+    return true;
+}
+
+static const vector<ContrastBackend> backends = {
+    {"scalar", [](PNMPicture& picture, const float coeff, const BackendOptions&) {
+        picture.modifyScalar(coeff);
+    }, alwaysAvailable},
+    {"simd", [](PNMPicture& picture, const float coeff, const BackendOptions&) {
+        picture.modify(coeff);
+    }, alwaysAvailable},
+    {"omp", [](PNMPicture& picture, const float coeff, const BackendOptions& options) {
+        // modifyParallelOmp раздаёт блоки через schedule(runtime)
+        const string& kind = options.scheduleKind;
+        omp_set_schedule(kind == "dynamic" ? omp_sched_dynamic
+                         : kind == "guided" ? omp_sched_guided : omp_sched_static, options.chunkSize);
+        picture.modifyParallelOmp(coeff, options.threadsCount);
+    }, alwaysAvailable},
+    {"threads", [](PNMPicture& picture, const float coeff, const BackendOptions& options) {
+        picture.modifyParallelCpp(coeff, options.threadsCount, options.scheduleKind, options.chunkSize);
+    }, alwaysAvailable},
+#ifdef CONTRAST_WITH_CUDA
+    {"cuda", [](PNMPicture& picture, const float coeff, const BackendOptions& options) {
+        picture.modifyParallelCUDA(coeff, options.deviceIndex);
+    }, cudaBackendAvailable},
+#endif
+};
+
+const vector<ContrastBackend>& contrastBackends() {
+    return backends;
+}
+
+const ContrastBackend* findBackend(const string& name) {
+    for (const auto& backend : backends) {
+        if (name == backend.name) {
+            return &backend;
+        }
+    }
+    return nullptr;
+}
+
+string backendNames() {
+    string names;
+    for (const auto& backend : backends) {
+        names += backend.name;
+        names += '|';
+    }
+    return names + "auto";
+}
@@ -0,0 +1,50 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_BACKEND_H
+#define TESTPROJECT_BACKEND_H
+
+#include <string>
+#include <vector>
+#include "pnm.h"
+
+using namespace std;
+
+// параметры запуска бэкенда; каждый берёт только своё
+struct BackendOptions {
+    int threadsCount = 1;
+    int deviceIndex = 0;
+    // omp и threads: расписание static / dynamic / guided и размер куска
+    // (у threads - в байтах, у omp - в блоках по 64 КБ, 0 - по умолчанию)
+    string scheduleKind = "static";
+    int chunkSize = 0;
+};
+
+// Бэкенд растяжения - одна и та же операция над PNMPicture своими средствами
+typedef void (*BackendModify)(PNMPicture& picture, const float coeff, const BackendOptions& options);
+typedef bool (*BackendAvailable)();
+
+struct ContrastBackend {
+    const char* name;
+    BackendModify modify;
+    // false - бэкенд собран, но на этой машине работать не может (нет GPU)
+    BackendAvailable isAvailable;
+};
+
+// Все бэкенды этой сборки: scalar, simd, omp, threads всегда,
+// cuda - только если при сборке нашёлся CUDA toolkit (CONTRAST_WITH_CUDA)
+const vector<ContrastBackend>& contrastBackends();
+
+// nullptr - бэкенда с таким именем в сборке нет; "auto" (autotune.h) сюда не входит
+const ContrastBackend* findBackend(const string& name);
+
+// имена через '|' - для справки и сообщений об ошибках
+string backendNames();
+
+#ifdef CONTRAST_WITH_CUDA
+// есть ли хотя бы одно CUDA-устройство; определена в pnm.cu
+bool cudaBackendAvailable();
+#endif
+
+#endif //TESTPROJECT_BACKEND_H
@@ -0,0 +1,208 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "batch.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <glob.h>
+
+using namespace std;
+
+unique_ptr<PNMPicture> PicturePool::acquire() {
+    lock_guard<mutex> guard(lock);
+    if (pictures.empty()) {
+        return make_unique<PNMPicture>();
+    }
+    auto picture = std::move(pictures.back());
+    pictures.pop_back();
+    return picture;
+}
+
+void PicturePool::release(unique_ptr<PNMPicture> picture) {
+    lock_guard<mutex> guard(lock);
+    pictures.push_back(std::move(picture));
+}
+
+static bool isImageFile(const filesystem::path& path) {
+    string extension = path.extension().string();
+    return extension == ".pnm" || extension == ".ppm" || extension == ".pgm";
+}
+
+vector<string> collectBatchInputs(const string& source) {
+    vector<string> inputs;
+
+    if (source.find_first_of("*?[") != string::npos) {
+        glob_t matches{};
+        if (glob(source.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) {
+                inputs.emplace_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    } else if (filesystem::is_directory(source)) {
+        for (const auto& entry : filesystem::directory_iterator(source)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                inputs.push_back(entry.path().string());
+            }
+        }
+        sort(inputs.begin(), inputs.end());
+    } else {
+        ifstream list(source);
+        if (!list.is_open()) {
+            throw runtime_error("Error while trying to open batch list " + source);
+        }
+        string line;
+        while (getline(list, line)) {
+            if (!line.empty()) {
+                inputs.push_back(line);
+            }
+        }
+    }
+
+    return inputs;
+}
+
+BatchStats processBatch(
+    const vector<string>& inputs,
+    const string& outputDir,
+    const float coeff,
+    const int threads_count,
+    const size_t largeImageSize,
+    const vector<PointOp>& point_ops
+) {
+    filesystem::create_directories(outputDir);
+
+    vector<string> smallInputs;
+    vector<string> largeInputs;
+    for (const auto& input : inputs) {
+        error_code error;
+        size_t fileSize = filesystem::file_size(input, error);
+        if (!error && fileSize >= largeImageSize) {
+            largeInputs.push_back(input);
+        } else {
+            smallInputs.push_back(input);
+        }
+    }
+
+    PicturePool picturePool;
+    atomic<size_t> imagesCount = 0;
+    atomic<size_t> failedCount = 0;
+    atomic<size_t> bytesCount = 0;
+
+    auto outputFor = [&outputDir](const string& input) {
+        return (filesystem::path(outputDir) / filesystem::path(input).filename()).string();
+    };
+
+    auto processOne = [&](const string& input) {
+        auto picture = picturePool.acquire();
+        // маленькие идут по одному на поток пула - и разбор P2/P3 однопоточный
+        picture->asciiThreadsCount = 1;
+        picture->pointOps = point_ops;
+        string output = outputFor(input);
+        try {
+            picture->read(input);
+            picture->modify(coeff);
+            picture->write(output);
+            imagesCount++;
+            bytesCount += picture->data_size;
+        } catch (exception& e) {
+            fprintf(stderr, "%s: %s\n", input.c_str(), e.what());
+            failedCount++;
+            // после ошибки у объекта могут остаться открытые файлы - в пул он не возвращается
+            picture = make_unique<PNMPicture>();
+        }
+        picturePool.release(std::move(picture));
+    };
+
+    auto start = chrono::steady_clock::now();
+
+    // Большие изображения по одному - внутри каждого работают все потоки.
+    // Пока текущее растягивается, следующее уже читается, а предыдущее
+    // дописывается: ввод-вывод отдельных потоков идёт вперемешку с вычислениями.
+    // Первое касание буфера и разбор/запись P2/P3 в потоках чтения и записи тоже
+    // идут на общем пуле: пул один на процесс и не пересоздаётся, а вызовы из разных
+    // потоков он выполняет по очереди - с растяжением совмещаются только fread/fwrite
+    auto readLarge = [&picturePool, &point_ops, threads_count](const string& input, unique_ptr<PNMPicture>& picture,
+                                                               exception_ptr& error) {
+        picture = picturePool.acquire();
+        // P2/P3 разбираются и пишутся на тех же потоках, что и растяжение
+        picture->asciiThreadsCount = threads_count;
+        picture->pointOps = point_ops;
+        try {
+            picture->read(input);
+        } catch (...) {
+            error = current_exception();
+        }
+    };
+
+    unique_ptr<PNMPicture> nextPicture;
+    exception_ptr nextError;
+    thread reader;
+    thread writer;
+    if (!largeInputs.empty()) {
+        reader = thread(readLarge, cref(largeInputs[0]), ref(nextPicture), ref(nextError));
+    }
+    for (size_t i = 0; i < largeInputs.size(); i++) {
+        reader.join();
+        unique_ptr<PNMPicture> picture = std::move(nextPicture);
+        exception_ptr error = nextError;
+        nextError = nullptr;
+        if (i + 1 < largeInputs.size()) {
+            reader = thread(readLarge, cref(largeInputs[i + 1]), ref(nextPicture), ref(nextError));
+        }
+
+        if (error) {
+            try {
+                rethrow_exception(error);
+            } catch (exception& e) {
+                fprintf(stderr, "%s: %s\n", largeInputs[i].c_str(), e.what());
+            }
+            failedCount++;
+            // после ошибки у объекта могут остаться открытые файлы - в пул он не возвращается
+            continue;
+        }
+
+        picture->modifyParallelCpp(coeff, threads_count, "static", 0);
+
+        if (writer.joinable()) {
+            writer.join();
+        }
+        writer = thread([&, input = largeInputs[i], picture = std::move(picture)]() mutable {
+            try {
+                picture->write(outputFor(input));
+                imagesCount++;
+                bytesCount += picture->data_size;
+            } catch (exception& e) {
+                fprintf(stderr, "%s: %s\n", input.c_str(), e.what());
+                failedCount++;
+                picture = make_unique<PNMPicture>();
+            }
+            picturePool.release(std::move(picture));
+        });
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    // маленькие - много сразу, каждый однопоточно
+    ThreadPool::shared(threads_count).parallelFor(
+        smallInputs.size(), "dynamic", 1,
+        [&](size_t index, size_t, int) {
+            processOne(smallInputs[index]);
+        }
+    );
+
+    BatchStats stats;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stats.imagesCount = imagesCount;
+    stats.failedCount = failedCount;
+    stats.bytesCount = bytesCount;
+    return stats;
+}
@@ -0,0 +1,53 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_BATCH_H
+#define TESTPROJECT_BATCH_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "pnm.h"
+
+using namespace std;
+
+struct BatchStats {
+    size_t imagesCount = 0;
+    size_t failedCount = 0;
+    size_t bytesCount = 0;
+    double seconds = 0;
+};
+
+// Пул объектов PNMPicture: буфер data и гистограмма остаются выделенными
+// между файлами, новый файл только переиспользует их ёмкость
+class PicturePool {
+public:
+    unique_ptr<PNMPicture> acquire();
+    void release(unique_ptr<PNMPicture> picture);
+
+private:
+    mutex lock;
+    vector<unique_ptr<PNMPicture>> pictures;
+};
+
+// Список входных файлов из source: каталог (все .pnm/.ppm/.pgm), glob-шаблон
+// (если есть * ? или [) или текстовый файл со списком путей по одному в строке
+vector<string> collectBatchInputs(const string& source);
+
+// Обрабатывает все inputs и пишет результаты с теми же именами в outputDir.
+// Файлы с телом меньше largeImageSize обрабатываются параллельно по одному
+// на поток, большие - по очереди, каждый на всех threads_count потоках; чтение
+// следующего большого и запись предыдущего идут в своих потоках параллельно с ним.
+// point_ops - операторы после растяжения каждого файла (PNMPicture::pointOps)
+BatchStats processBatch(
+    const vector<string>& inputs,
+    const string& outputDir,
+    const float coeff,
+    const int threads_count,
+    const size_t largeImageSize,
+    const vector<PointOp>& point_ops = {}
+);
+
+#endif //TESTPROJECT_BATCH_H
@@ -0,0 +1,416 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pnm.h"
+#include "backend.h"
+#include "args_parser.h"
+#include "csv_writer.h"
+#include "histogram.h"
+#include "histogram_reduction.h"
+#include "remap.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace constants {
+    static string helpFlag = "--help";
+    static string sizesParam = "--sizes";
+    static string formatsParam = "--formats";
+    static string depthsParam = "--depths";
+    static string distributionsParam = "--distributions";
+    static string backendsParam = "--backends";
+    static string threadsParam = "--threads";
+    static string schedulesParam = "--schedules";
+    static string chunksParam = "--chunks";
+    static string warmupParam = "--warmup";
+    static string repetitionsParam = "--repetitions";
+    static string outputParam = "--output";
+    static string coefParam = "--coef";
+    static string mergeFlag = "--merge";
+    static string binsParam = "--bins";
+    static string remapFlag = "--remap";
+}
+
+void printHelp() {
+    string output = "========= contrast_bench =========\n";
+    output.append(constants::sizesParam + " [WxH,...] - image sizes (default 1920x1080,4096x4096)\n");
+    output.append(constants::formatsParam + " [5,6] - PNM formats (default 5,6)\n");
+    output.append(constants::depthsParam + " [8,16] - bits per sample (default 8,16)\n");
+    output.append(constants::distributionsParam + " [uniform,gaussian,narrow,bimodal] - pixel values distribution (default gaussian)\n");
+    output.append(constants::backendsParam + " [scalar,simd,omp,threads,...] - backends to sweep (default all available)\n");
+    output.append(constants::threadsParam + " [n,...] - threads counts (default 1,2,4,...,all cores)\n");
+    output.append(constants::schedulesParam + " [static,dynamic,guided] - schedules (default static,dynamic)\n");
+    output.append(constants::chunksParam + " [n,...] - chunk sizes, 0 - schedule default (default 0,4096,65536)\n");
+    output.append(constants::warmupParam + " [n] - warmup runs per configuration (default 2)\n");
+    output.append(constants::repetitionsParam + " [n] - measured runs per configuration (default 10)\n");
+    output.append(constants::coefParam + " [coef] - coefficient for ignoring not important colors (default 0.00390625)\n");
+    output.append(constants::remapFlag + " - only remap kernels, one thread: selected (" + string(remapKernelName()) + ") vs scalar table, over " + constants::sizesParam + " and " + constants::formatsParam + "\n");
+    output.append(constants::mergeFlag + " - only merge of per-thread histograms: reduction vs mutex\n");
+    output.append(constants::binsParam + " [n,...] - bins counts for " + constants::mergeFlag + " (default 256,65536)\n");
+    output.append(constants::outputParam + " [fname] - CSV output (default bench.csv)\n\n");
+    printf("%s", output.c_str());
+}
+
+static vector<string> split(const string& value, char separator) {
+    vector<string> parts;
+    stringstream stream(value);
+    string part;
+    while (getline(stream, part, separator)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+static string argOr(map<string, string>& argsMap, const string& name, const string& fallback) {
+    const string& value = argsMap[name];
+    return value.empty() || value == args_parser_constants::trueFlagValue ? fallback : value;
+}
+
+static void reportIncorrect(const string& name) {
+    fprintf(stderr, "Incorrect value for %s\n", name.c_str());
+}
+
+// значение флага name (или fallback) числом; false - "Incorrect value for <name>" в stderr
+template <typename T>
+static bool parseArg(map<string, string>& argsMap, const string& name, const string& fallback, T& value) {
+    if (!parseNumber(argOr(argsMap, name, fallback), value)) {
+        reportIncorrect(name);
+        return false;
+    }
+    return true;
+}
+
+// список чисел через запятую, ошибки - как у parseArg
+static bool parseInts(map<string, string>& argsMap, const string& name, const string& fallback, vector<int>& numbers) {
+    numbers.clear();
+    for (const auto& part : split(argOr(argsMap, name, fallback), ',')) {
+        int number = 0;
+        if (!parseNumber(part, number)) {
+            reportIncorrect(name);
+            return false;
+        }
+        numbers.push_back(number);
+    }
+    return true;
+}
+
+struct ImageSize {
+    string name;
+    int width;
+    int height;
+};
+
+// размеры WxH через запятую, обе стороны положительные
+static bool parseSizes(map<string, string>& argsMap, const string& name, const string& fallback, vector<ImageSize>& sizes) {
+    for (const auto& part : split(argOr(argsMap, name, fallback), ',')) {
+        auto dimensions = split(part, 'x');
+        ImageSize size{part, 0, 0};
+        if (dimensions.size() != 2 || !parseNumber(dimensions[0], size.width) || !parseNumber(dimensions[1], size.height)
+            || size.width <= 0 || size.height <= 0) {
+            reportIncorrect(name);
+            return false;
+        }
+        sizes.push_back(size);
+    }
+    return true;
+}
+
+// синтетическое изображение: значения из заданного распределения,
+// узкие распределения дают картинку, которую действительно надо растягивать.
+// 16-битные отсчёты - то же распределение в масштабе 0..65535, big-endian
+static void generatePicture(PNMPicture& picture, int format, int depth, int width, int height, const string& distribution) {
+    picture.format = format;
+    picture.width = width;
+    picture.height = height;
+    picture.colors = depth == 16 ? 65535 : 255;
+    picture.channelsCount = format == 6 ? 3 : 1;
+    picture.bytesPerSample = depth == 16 ? 2 : 1;
+    picture.data_size = size_t(width) * height * picture.channelsCount * picture.bytesPerSample;
+    picture.data.resize(picture.data_size);
+
+    mt19937 generator(42);
+    uniform_int_distribution<int> uniform(0, 255);
+    normal_distribution<float> gaussian(120, 25);
+    uniform_int_distribution<int> narrow(90, 160);
+    bernoulli_distribution isDark(0.5);
+    normal_distribution<float> dark(60, 15);
+    normal_distribution<float> bright(190, 15);
+
+    const size_t samplesCount = picture.data_size / picture.bytesPerSample;
+    for (size_t i = 0; i < samplesCount; i++) {
+        float v;
+        if (distribution == "uniform") {
+            v = float(uniform(generator));
+        } else if (distribution == "narrow") {
+            v = float(narrow(generator));
+        } else if (distribution == "bimodal") {
+            v = isDark(generator) ? dark(generator) : bright(generator);
+        } else {
+            v = gaussian(generator);
+        }
+        if (depth == 16) {
+            int value = clamp(int(v * 257), 0, 65535);
+            picture.data[2 * i] = uchar(value >> 8);
+            picture.data[2 * i + 1] = uchar(value & 0xff);
+        } else {
+            picture.data[i] = uchar(clamp(int(v), 0, 255));
+        }
+    }
+}
+
+static double percentile(vector<double> sorted, double p) {
+    sort(sorted.begin(), sorted.end());
+    size_t index = size_t(ceil(p * double(sorted.size()))) - 1;
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+// только remap одним потоком: выбранное ядро remapApply / remapApplyRgb против
+// скалярной таблицы на одних и тех же данных - выигрыш векторного ядра виден напрямую
+static void benchmarkRemap(CSVWriter& writer, const vector<ImageSize>& sizes, const vector<int>& formats,
+                           int warmup, int repetitions) {
+    for (const auto& size : sizes) {
+        for (int format : formats) {
+            PNMPicture picture;
+            generatePicture(picture, format, 8, size.width, size.height, "uniform");
+            const uchar* s = picture.data.data();
+            vector<uchar> d(picture.data_size);
+            const size_t pixelsCount = picture.data_size / 3;
+            uchar tables[3 * 256];
+            for (int channel = 0; channel < 3; channel++) {
+                buildRemapTable(uchar(20 + 10 * channel), 220, tables + 256 * channel);
+            }
+
+            const string imageName = "remap_P" + to_string(format) + "_" + size.name;
+            for (const auto& kernelName : vector<string>{"scalar", remapKernelName()}) {
+                const bool isScalar = kernelName == "scalar";
+                vector<double> times;
+                for (int run = 0; run < warmup + repetitions; run++) {
+                    auto start = chrono::steady_clock::now();
+                    if (format == 6) {
+                        (isScalar ? remapApplyRgbScalar : remapApplyRgb)(s, d.data(), pixelsCount, tables);
+                    } else {
+                        (isScalar ? remapApplyScalar : remapApply)(s, d.data(), picture.data_size, tables);
+                    }
+                    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                    if (run >= warmup) {
+                        times.push_back(elapsed);
+                    }
+                }
+
+                double median = percentile(times, 0.5);
+                double p95 = percentile(times, 0.95);
+                double minTime = *min_element(times.begin(), times.end());
+                double gbps = double(picture.data_size) / (median / 1000) / 1e9;
+                writer.writeBenchmark(imageName, kernelName, 1, "none", 0, repetitions, median, p95, minTime, gbps, 0);
+                printf("%s %s: median %lg ms, p95 %lg ms, %lg GB/s\n",
+                       imageName.c_str(), kernelName.c_str(), median, p95, gbps);
+                if (isScalar && kernelName == remapKernelName()) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// только свёртка частичных гистограмм, без накопления: строки потоков заполнены заранее.
+// "mutex" - прежняя схема (каждый поток под блокировкой добавляет свою строку в общую,
+// как omp critical), "reduction" - HistogramReduction::reduce по столбцам.
+// В CSV gbps - байты всех строк на медиану
+static void benchmarkMerge(CSVWriter& writer, const vector<int>& bins_counts, const vector<int>& threads_counts,
+                           int warmup, int repetitions) {
+    for (int bins : bins_counts) {
+        for (int threads : threads_counts) {
+            ThreadTeam pool = ThreadPool::shared(threads);
+            HistogramReduction<size_t> reduction(pool.size(), size_t(bins));
+            for (int row = 0; row < pool.size(); row++) {
+                for (int b = 0; b < bins; b++) {
+                    reduction.row(row)[b] = size_t(row + b);
+                }
+            }
+            vector<size_t> result(bins);
+            mutex lock;
+
+            const size_t bytes = size_t(pool.size()) * bins * sizeof(size_t);
+            const string imageName = "merge_" + to_string(bins) + "bins";
+            for (const auto& method : vector<string>{"mutex", "reduction"}) {
+                vector<double> times;
+                for (int run = 0; run < warmup + repetitions; run++) {
+                    auto start = chrono::steady_clock::now();
+                    if (method == "mutex") {
+                        fill(result.begin(), result.end(), 0);
+                        pool.run([&reduction, &result, &lock, bins](int thread_index) {
+                            const size_t* els = reduction.row(thread_index);
+                            lock_guard<mutex> guard(lock);
+                            for (int b = 0; b < bins; b++) {
+                                result[b] += els[b];
+                            }
+                        });
+                    } else {
+                        reduction.reduce(result.data(), threads);
+                    }
+                    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                    if (run >= warmup) {
+                        times.push_back(elapsed);
+                    }
+                }
+
+                double median = percentile(times, 0.5);
+                double p95 = percentile(times, 0.95);
+                double minTime = *min_element(times.begin(), times.end());
+                double gbps = double(bytes) / (median / 1000) / 1e9;
+                writer.writeBenchmark(imageName, method, threads, "static", 0, repetitions,
+                                      median, p95, minTime, gbps, 0);
+                printf("%s %s threads=%d: median %lg ms, p95 %lg ms, %lg GB/s\n",
+                       imageName.c_str(), method.c_str(), threads, median, p95, gbps);
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    map<string, string> argsMap = {};
+    parseArguments(argsMap, argc, argv);
+
+    if (argsMap[constants::helpFlag] == args_parser_constants::trueFlagValue) {
+        printHelp();
+        return 0;
+    }
+
+    int coresCount = max(int(thread::hardware_concurrency()), 1);
+    string defaultThreads;
+    for (int threads = 1; threads < coresCount; threads *= 2) {
+        defaultThreads += to_string(threads) + ",";
+    }
+    defaultThreads += to_string(coresCount);
+
+    vector<ImageSize> sizes;
+    vector<int> formats;
+    vector<int> depths;
+    if (!parseSizes(argsMap, constants::sizesParam, "1920x1080,4096x4096", sizes)
+        || !parseInts(argsMap, constants::formatsParam, "5,6", formats)
+        || !parseInts(argsMap, constants::depthsParam, "8,16", depths)) {
+        return 1;
+    }
+    vector<string> distributions = split(argOr(argsMap, constants::distributionsParam, "gaussian"), ',');
+    string availableBackends;
+    for (const auto& backend : contrastBackends()) {
+        if (backend.isAvailable()) {
+            availableBackends += availableBackends.empty() ? backend.name : string(",") + backend.name;
+        }
+    }
+    vector<string> backends = split(argOr(argsMap, constants::backendsParam, availableBackends), ',');
+    for (const auto& backend : backends) {
+        if (findBackend(backend) == nullptr || !findBackend(backend)->isAvailable()) {
+            fprintf(stderr, "Unsupported backend %s, available %s\n", backend.c_str(), availableBackends.c_str());
+            return 1;
+        }
+    }
+    vector<int> threadsCounts;
+    vector<int> chunkSizes;
+    vector<int> binsCounts;
+    int warmup = 0;
+    int repetitions = 0;
+    float coeff = 0;
+    if (!parseInts(argsMap, constants::threadsParam, defaultThreads, threadsCounts)
+        || !parseInts(argsMap, constants::chunksParam, "0,4096,65536", chunkSizes)
+        || !parseInts(argsMap, constants::binsParam, "256,65536", binsCounts)
+        || !parseArg(argsMap, constants::warmupParam, "2", warmup)
+        || !parseArg(argsMap, constants::repetitionsParam, "10", repetitions)
+        || !parseArg(argsMap, constants::coefParam, "0.00390625", coeff)) {
+        return 1;
+    }
+    repetitions = max(repetitions, 1);
+    // общий пул создаётся один раз - под самое большое число потоков прогона
+    int poolSize = coresCount;
+    for (int threads : threadsCounts) {
+        poolSize = max(poolSize, threads);
+    }
+    ThreadPool::configureShared(poolSize);
+    vector<string> schedules = split(argOr(argsMap, constants::schedulesParam, "static,dynamic"), ',');
+
+    CSVWriter writer(argOr(argsMap, constants::outputParam, "bench.csv"), true);
+    if (argsMap[constants::remapFlag] == args_parser_constants::trueFlagValue) {
+        benchmarkRemap(writer, sizes, formats, warmup, repetitions);
+        return 0;
+    }
+    if (argsMap[constants::mergeFlag] == args_parser_constants::trueFlagValue) {
+        benchmarkMerge(writer, binsCounts, threadsCounts, warmup, repetitions);
+        return 0;
+    }
+    printf("histogram kernel: %s, remap kernel: %s\n", histogramKernelName(), remapKernelName());
+
+    for (const auto& size : sizes) {
+        int width = size.width;
+        int height = size.height;
+
+        for (int format : formats) {
+            for (int depth : depths) {
+                for (const auto& distribution : distributions) {
+                    PNMPicture picture;
+                    generatePicture(picture, format, depth, width, height, distribution);
+                    const vector<uchar> original(picture.data.begin(), picture.data.end());
+                    // GB/s считаются по байтам - 16-битные строки сравнимы с 8-битными напрямую
+                    string imageName = "P";
+                    imageName += to_string(format) + "_" + to_string(depth) + "bit_" + size.name + "_" + distribution;
+
+                    for (const auto& backend : backends) {
+                        // потоки, расписания и куски перебираются только у omp и threads
+                        bool isSwept = backend == "omp" || backend == "threads";
+                        for (int threads : isSwept ? threadsCounts : vector<int>{1}) {
+                            for (const auto& schedule : isSwept ? schedules : vector<string>{"none"}) {
+                                for (int chunk : isSwept ? chunkSizes : vector<int>{0}) {
+                                    // в OMP-бэкенде schedule(runtime) раздаёт блоки по 64 КБ, chunk - в блоках
+                                    BackendOptions options;
+                                    options.threadsCount = threads;
+                                    options.scheduleKind = isSwept ? schedule : "static";
+                                    options.chunkSize = chunk;
+
+                                    vector<double> times;
+                                    double histogramGBps = 0;
+                                    for (int run = 0; run < warmup + repetitions; run++) {
+                                        memcpy(picture.data.data(), original.data(), original.size());
+
+                                        auto start = chrono::steady_clock::now();
+                                        findBackend(backend)->modify(picture, coeff, options);
+                                        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+                                        if (run >= warmup) {
+                                            times.push_back(elapsed);
+                                            histogramGBps += picture.histogramGBps / repetitions;
+                                        }
+                                    }
+
+                                    double median = percentile(times, 0.5);
+                                    double p95 = percentile(times, 0.95);
+                                    double minTime = *min_element(times.begin(), times.end());
+                                    double gbps = double(picture.data_size) / (median / 1000) / 1e9;
+
+                                    writer.writeBenchmark(imageName, backend, threads, schedule, chunk, repetitions,
+                                                          median, p95, minTime, gbps, histogramGBps);
+                                    printf("%s %s threads=%d %s chunk=%d: median %lg ms, p95 %lg ms, %lg GB/s\n",
+                                           imageName.c_str(), backend.c_str(), threads, schedule.c_str(), chunk,
+                                           median, p95, gbps);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
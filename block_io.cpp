@@ -0,0 +1,601 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "block_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef CONTRAST_WITH_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+// O_DIRECT требует выравнивания смещения, длины и адреса буфера
+static constexpr size_t directAlignment = 4096;
+
+static string ioKind = "auto";
+static bool isDirect = false;
+static size_t blockSize = 1 << 20;
+static int queueDepth = 8;
+
+// один запрос: length байт между buffer и файлом с offset; required - сколько из них
+// обязательно должно дойти (у чтения O_DIRECT последний блок выходит за конец файла);
+// alignment - с какой кратностью можно продолжать недоданный запрос (у O_DIRECT - 4096)
+struct Transfer {
+    int fd;
+    uchar* buffer;
+    size_t length;
+    size_t offset;
+    size_t required;
+    size_t alignment = 1;
+};
+
+// Запрос с position передал result байт. Остаток продолжается с position, выровненного
+// вниз по alignment: O_DIRECT не примет невыровненные адрес и смещение, недовыровненный
+// хвост передаётся снова. false - запрос ничего не продвинул (конец файла раньше required)
+static bool advanceTransfer(const Transfer& transfer, size_t& position, size_t result) noexcept {
+    size_t done = position + result;
+    if (done >= transfer.required) {
+        position = done;
+        return true;
+    }
+    size_t next = done / transfer.alignment * transfer.alignment;
+    if (next == position) {
+        return false;
+    }
+    position = next;
+    return true;
+}
+
+// Передача, разбитая на blocksCount блоков. prepare готовит блок в ячейке slot
+// (у O_DIRECT ячейка - свой промежуточный буфер), complete вызывается, когда блок
+// целиком передан. Оба движка ниже гоняют один и тот же план
+struct TransferPlan {
+    bool isWrite;
+    size_t blocksCount;
+    function<Transfer(size_t block, int slot)> prepare;
+    function<void(size_t block, int slot)> complete;
+};
+
+#ifdef CONTRAST_WITH_IO_URING
+// Минимальное кольцо io_uring на голых системных вызовах - без зависимости от liburing.
+// Очереди отображаются из ядра; хвост SQ и голова CQ публикуются с release,
+// чужие индексы читаются с acquire
+class IoRing {
+public:
+    explicit IoRing(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            throw runtime_error("io_uring is not available");
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool isSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (isSingleMap) {
+            sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqRing = isSingleMap ? sqRing
+                             : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+            release();
+            throw runtime_error("io_uring is not available");
+        }
+
+        uchar* sq = (uchar*)sqRing;
+        sqHead = (unsigned*)(sq + params.sq_off.head);
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        sqLocalTail = *sqTail;
+
+        uchar* cq = (uchar*)cqRing;
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+    }
+
+    ~IoRing() {
+        release();
+    }
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    bool registerBuffers(const vector<iovec>& buffers) noexcept {
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers.data(), unsigned(buffers.size())) == 0;
+    }
+
+    // nullptr - очередь полна
+    io_uring_sqe* nextSqe() noexcept {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (sqLocalTail - head >= sqEntries) {
+            return nullptr;
+        }
+        unsigned index = sqLocalTail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        sqLocalTail++;
+        pendingCount++;
+        return sqe;
+    }
+
+    // отдаёт ядру накопленные запросы и ждёт хотя бы wait_count завершений
+    void submit(unsigned wait_count) {
+        __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+        while (true) {
+            long result = syscall(__NR_io_uring_enter, fd, pendingCount, wait_count,
+                                  wait_count > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (result >= 0) {
+                pendingCount -= unsigned(result);
+                return;
+            }
+            if (errno != EINTR) {
+                throw runtime_error("io_uring submission failed");
+            }
+        }
+    }
+
+    // Без SQPOLL ядро забирает запросы только внутри io_uring_enter: после его ошибки
+    // не забранные запросы снимаются с очереди. Возвращает их user_data
+    vector<unsigned long long> withdrawPending() {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        vector<unsigned long long> withdrawn;
+        for (unsigned i = head; i != sqLocalTail; i++) {
+            withdrawn.push_back(sqes[sqArray[i & sqMask]].user_data);
+        }
+        sqLocalTail = head;
+        __atomic_store_n(sqTail, head, __ATOMIC_RELEASE);
+        pendingCount = 0;
+        return withdrawn;
+    }
+
+    // ждёт хотя бы одного завершения, ничего не отправляя; false - ядро отказало
+    bool wait() noexcept {
+        while (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+            // EBUSY/EAGAIN - переполнена очередь завершений, её разбирает вызывающий
+            if (errno == EBUSY || errno == EAGAIN) {
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool popCompletion(io_uring_cqe& cqe) noexcept {
+        unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        cqe = cqes[head & cqMask];
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    void release() noexcept {
+        if (sqes != nullptr && sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != nullptr && cqRing != MAP_FAILED && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != nullptr && sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    int fd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned sqLocalTail = 0;
+    unsigned pendingCount = 0;
+
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+};
+#endif
+
+// кольцо и промежуточные буферы O_DIRECT - свои у каждого потока
+struct IoContext {
+#ifdef CONTRAST_WITH_IO_URING
+    unique_ptr<IoRing> ring;
+    bool isRingChecked = false;
+    // промежуточные буферы зарегистрированы в кольце - READ_FIXED/WRITE_FIXED
+    bool isFixed = false;
+#endif
+    uchar* staging = nullptr;
+    size_t stagingSize = 0;
+
+    ~IoContext() {
+        if (staging != nullptr) {
+            munmap(staging, stagingSize);
+        }
+    }
+
+    uchar* stagingBuffers() {
+        if (staging == nullptr) {
+            stagingSize = blockSize * queueDepth;
+            void* ptr = mmap(nullptr, stagingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                throw runtime_error("Error while trying to allocate I/O buffers");
+            }
+            staging = (uchar*)ptr;
+        }
+        return staging;
+    }
+
+#ifdef CONTRAST_WITH_IO_URING
+    // nullptr - io_uring выключен или ядро его не даёт
+    IoRing* uring() {
+        if (!isRingChecked) {
+            isRingChecked = true;
+            if (ioKind == "uring" || ioKind == "auto") {
+                try {
+                    ring = make_unique<IoRing>(unsigned(queueDepth));
+                } catch (exception&) {
+                    ring = nullptr;
+                }
+            }
+            if (ring != nullptr && isDirect) {
+                vector<iovec> buffers(queueDepth);
+                for (int slot = 0; slot < queueDepth; slot++) {
+                    buffers[slot].iov_base = stagingBuffers() + slot * blockSize;
+                    buffers[slot].iov_len = blockSize;
+                }
+                // не хватило RLIMIT_MEMLOCK - те же буферы, но без регистрации
+                isFixed = ring->registerBuffers(buffers);
+            }
+        }
+        return ring.get();
+    }
+#endif
+};
+
+static thread_local IoContext context;
+
+static void runPread(const TransferPlan& plan) {
+    for (size_t block = 0; block < plan.blocksCount; block++) {
+        Transfer transfer = plan.prepare(block, 0);
+        size_t position = 0;
+        while (position < transfer.required) {
+            ssize_t result = plan.isWrite
+                ? pwrite(transfer.fd, transfer.buffer + position, transfer.length - position, off_t(transfer.offset + position))
+                : pread(transfer.fd, transfer.buffer + position, transfer.length - position, off_t(transfer.offset + position));
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result < 0 || !advanceTransfer(transfer, position, size_t(result))) {
+                throw runtime_error(plan.isWrite ? "Error while trying to write to file" : "Error while trying to read file");
+            }
+        }
+        plan.complete(block, 0);
+    }
+}
+
+#ifdef CONTRAST_WITH_IO_URING
+// До queueDepth блоков в полёте: свободные ячейки сразу получают следующие блоки,
+// недочитанный блок отправляется снова с того места, где остановился (см. advanceTransfer).
+// После ошибки - и ввода-вывода, и самого io_uring_enter - новые блоки не отправляются,
+// не принятые ядром снимаются с очереди, а принятые дожидаются: иначе ядро писало бы
+// в освобождённую или уже занятую следующим запросом память
+static void runUring(IoRing& ring, const TransferPlan& plan, bool is_fixed) {
+    struct Slot {
+        size_t block;
+        Transfer transfer;
+        size_t position;
+    };
+    vector<Slot> slots(queueDepth);
+    vector<int> freeSlots;
+    for (int slot = queueDepth - 1; slot >= 0; slot--) {
+        freeSlots.push_back(slot);
+    }
+
+    auto submitSlot = [&ring, &slots, &plan, is_fixed](int slot) {
+        io_uring_sqe* sqe = ring.nextSqe();
+        const Slot& s = slots[slot];
+        if (plan.isWrite) {
+            sqe->opcode = is_fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        } else {
+            sqe->opcode = is_fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        }
+        sqe->fd = s.transfer.fd;
+        sqe->addr = (unsigned long long)(s.transfer.buffer + s.position);
+        sqe->len = unsigned(s.transfer.length - s.position);
+        sqe->off = s.transfer.offset + s.position;
+        sqe->buf_index = is_fixed ? (unsigned short)slot : 0;
+        sqe->user_data = (unsigned long long)slot;
+    };
+
+    size_t nextBlock = 0;
+    size_t inFlight = 0;
+    bool isFailed = false;
+    while (true) {
+        while (!isFailed && nextBlock < plan.blocksCount && !freeSlots.empty()) {
+            int slot = freeSlots.back();
+            freeSlots.pop_back();
+            slots[slot] = {nextBlock, plan.prepare(nextBlock, slot), 0};
+            submitSlot(slot);
+            nextBlock++;
+            inFlight++;
+        }
+        if (inFlight == 0) {
+            break;
+        }
+
+        try {
+            ring.submit(1);
+        } catch (exception&) {
+            isFailed = true;
+            for (unsigned long long slot : ring.withdrawPending()) {
+                freeSlots.push_back(int(slot));
+                inFlight--;
+            }
+            // принятые ядром запросы надо дождаться, а ждать больше нечем
+            if (inFlight > 0 && !ring.wait()) {
+                fprintf(stderr, "io_uring failed with requests in flight\n");
+                abort();
+            }
+        }
+
+        io_uring_cqe cqe;
+        while (ring.popCompletion(cqe)) {
+            int slot = int(cqe.user_data);
+            Slot& s = slots[slot];
+            if (cqe.res < 0 || !advanceTransfer(s.transfer, s.position, size_t(cqe.res))) {
+                isFailed = true;
+            }
+            if (!isFailed && s.position < s.transfer.required) {
+                submitSlot(slot);
+                continue;
+            }
+            if (!isFailed) {
+                plan.complete(s.block, slot);
+            }
+            freeSlots.push_back(slot);
+            inFlight--;
+        }
+    }
+
+    if (isFailed) {
+        throw runtime_error(plan.isWrite ? "Error while trying to write to file" : "Error while trying to read file");
+    }
+}
+#endif
+
+static void run(const TransferPlan& plan, bool uses_staging) {
+#ifdef CONTRAST_WITH_IO_URING
+    IoRing* ring = context.uring();
+    if (ring != nullptr) {
+        runUring(*ring, plan, uses_staging && context.isFixed);
+        return;
+    }
+#endif
+    runPread(plan);
+}
+
+static size_t alignUp(size_t value) {
+    return (value + directAlignment - 1) / directAlignment * directAlignment;
+}
+
+BlockFile::~BlockFile() {
+    close();
+}
+
+void BlockFile::openRead(const string& fileName) {
+    close();
+    fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw runtime_error("Error while trying to open input file");
+    }
+    if (isDirect) {
+        // tmpfs и часть сетевых ФС не умеют O_DIRECT - тогда обычный путь
+        directFd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    }
+}
+
+void BlockFile::create(const string& fileName) {
+    close();
+    fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Error while trying to open output file");
+    }
+    if (isDirect) {
+        directFd = open(fileName.c_str(), O_WRONLY | O_CLOEXEC | O_DIRECT);
+    }
+}
+
+void BlockFile::openWrite(const string& fileName) {
+    close();
+    fd = open(fileName.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw runtime_error("Error while trying to open output file");
+    }
+}
+
+void BlockFile::close() noexcept {
+    if (directFd >= 0) {
+        ::close(directFd);
+        directFd = -1;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+size_t BlockFile::size() const {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        throw runtime_error("Error while trying to read file");
+    }
+    return size_t(info.st_size);
+}
+
+void BlockFile::read(uchar* d, size_t length, size_t offset) {
+    TransferPlan plan;
+    plan.isWrite = false;
+
+    if (directFd < 0) {
+        plan.blocksCount = (length + blockSize - 1) / blockSize;
+        plan.prepare = [this, d, length, offset](size_t block, int) {
+            size_t start = block * blockSize;
+            size_t blockLength = min(blockSize, length - start);
+            return Transfer{fd, d + start, blockLength, offset + start, blockLength};
+        };
+        plan.complete = [](size_t, int) {};
+        run(plan, false);
+        return;
+    }
+
+    // выровненный диапазон вокруг [offset, offset + length) читается в промежуточные
+    // буферы, нужная часть каждого блока копируется в d
+    const size_t alignedStart = offset / directAlignment * directAlignment;
+    const size_t alignedEnd = alignUp(offset + length);
+    const size_t end = offset + length;
+    uchar* staging = context.stagingBuffers();
+    plan.blocksCount = (alignedEnd - alignedStart + blockSize - 1) / blockSize;
+    plan.prepare = [this, staging, alignedStart, alignedEnd, end](size_t block, int slot) {
+        size_t start = alignedStart + block * blockSize;
+        size_t blockLength = min(blockSize, alignedEnd - start);
+        return Transfer{directFd, staging + slot * blockSize, blockLength, start, min(start + blockLength, end) - start,
+                        directAlignment};
+    };
+    plan.complete = [d, staging, alignedStart, alignedEnd, offset, end](size_t block, int slot) {
+        size_t start = alignedStart + block * blockSize;
+        size_t blockEnd = min(start + blockSize, alignedEnd);
+        size_t from = max(start, offset);
+        size_t to = min(blockEnd, end);
+        if (from < to) {
+            memcpy(d + (from - offset), staging + slot * blockSize + (from - start), to - from);
+        }
+    };
+    run(plan, true);
+}
+
+void BlockFile::write(const uchar* d, size_t length, size_t offset) {
+    TransferPlan plan;
+    plan.isWrite = true;
+    plan.blocksCount = (length + blockSize - 1) / blockSize;
+    plan.prepare = [this, d, length, offset](size_t block, int) {
+        size_t start = block * blockSize;
+        size_t blockLength = min(blockSize, length - start);
+        return Transfer{fd, (uchar*)d + start, blockLength, offset + start, blockLength};
+    };
+    plan.complete = [](size_t, int) {};
+    run(plan, false);
+}
+
+void BlockFile::writeAll(const uchar* header, size_t header_length, const uchar* d, size_t length) {
+    TransferPlan plan;
+    plan.isWrite = true;
+    plan.complete = [](size_t, int) {};
+
+    if (directFd < 0) {
+        // блок 0 - заголовок, дальше тело прямо из d
+        plan.blocksCount = 1 + (length + blockSize - 1) / blockSize;
+        plan.prepare = [this, header, header_length, d, length](size_t block, int) {
+            if (block == 0) {
+                return Transfer{fd, (uchar*)header, header_length, 0, header_length};
+            }
+            size_t start = (block - 1) * blockSize;
+            size_t blockLength = min(blockSize, length - start);
+            return Transfer{fd, (uchar*)d + start, blockLength, header_length + start, blockLength};
+        };
+        run(plan, false);
+        return;
+    }
+
+    // заголовок и тело собираются в промежуточных буферах, последний блок дополняется
+    // нулями до выравнивания, лишнее потом отрезается
+    const size_t total = header_length + length;
+    const size_t alignedTotal = alignUp(total);
+    uchar* staging = context.stagingBuffers();
+    plan.blocksCount = (alignedTotal + blockSize - 1) / blockSize;
+    plan.prepare = [this, header, header_length, d, total, alignedTotal, staging](size_t block, int slot) {
+        size_t start = block * blockSize;
+        size_t blockLength = min(blockSize, alignedTotal - start);
+        uchar* buffer = staging + slot * blockSize;
+        size_t filled = 0;
+        if (start < header_length) {
+            filled = min(header_length - start, blockLength);
+            memcpy(buffer, header + start, filled);
+        }
+        size_t dataEnd = min(start + blockLength, total);
+        if (start + filled < dataEnd) {
+            memcpy(buffer + filled, d + (start + filled - header_length), dataEnd - start - filled);
+            filled = dataEnd - start;
+        }
+        memset(buffer + filled, 0, blockLength - filled);
+        return Transfer{directFd, buffer, blockLength, start, blockLength, directAlignment};
+    };
+    run(plan, true);
+
+    if (ftruncate(fd, off_t(total)) != 0) {
+        throw runtime_error("Error while trying to write to file");
+    }
+}
+
+bool BlockFile::configure(const string& kind, bool direct, size_t block_size, int queue_depth) {
+    if (kind != "auto" && kind != "uring" && kind != "pread" && kind != "stdio") {
+        return false;
+    }
+    ioKind = kind;
+    isDirect = direct;
+    blockSize = max(alignUp(block_size), directAlignment);
+    queueDepth = max(queue_depth, 1);
+    return true;
+}
+
+bool BlockFile::isUsable(const string& fileName) {
+    if (ioKind == "stdio") {
+        return false;
+    }
+    struct stat info;
+    if (stat(fileName.c_str(), &info) != 0) {
+        // файла ещё нет - будет создан обычным
+        return errno == ENOENT;
+    }
+    return S_ISREG(info.st_mode);
+}
@@ -0,0 +1,61 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_BLOCK_IO_H
+#define TESTPROJECT_BLOCK_IO_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Файл, который читается и пишется большими блоками по дескриптору вместо FILE*.
+// Способ задаётся один раз на процесс (configure):
+// - "uring" - io_uring, до queue_depth блоков в полёте одновременно; кольцо у каждого
+//   потока своё (пакетный режим читает файлы из многих потоков). Есть только в сборке
+//   с CONTRAST_WITH_IO_URING, если ядро не даёт создать кольцо - как pread;
+// - "pread" - pread/pwrite по блоку за раз;
+// - "stdio" - блочный путь выключен, PNMPicture читает и пишет через FILE* как раньше;
+// - "auto" (по умолчанию) - uring, если он есть, иначе pread.
+// direct = true - O_DIRECT мимо page cache: блоки идут через выровненные промежуточные
+// буферы (у uring они зарегистрированы в кольце), файловая система без O_DIRECT -
+// обычный путь. Ошибки ввода-вывода - runtime_error
+class BlockFile {
+public:
+    BlockFile() = default;
+    ~BlockFile();
+
+    BlockFile(const BlockFile&) = delete;
+    BlockFile& operator=(const BlockFile&) = delete;
+
+    void openRead(const string& fileName);
+    // создаёт (или обрезает) файл на запись
+    void create(const string& fileName);
+    // существующий файл на запись без обрезки - в него пишут кусками, в том числе
+    // из разных процессов
+    void openWrite(const string& fileName);
+    void close() noexcept;
+
+    size_t size() const;
+    // length байт с offset в d; файл короче - runtime_error
+    void read(uchar* d, size_t length, size_t offset);
+    // length байт из d с offset; границы кусков произвольны, поэтому без O_DIRECT
+    void write(const uchar* d, size_t length, size_t offset);
+    // весь файл с начала: header, сразу за ним тело d
+    void writeAll(const uchar* header, size_t header_length, const uchar* d, size_t length);
+
+    // kind - см. выше; block_size кратен 4096. Возвращает false для неизвестного способа
+    static bool configure(const string& kind, bool direct, size_t block_size, int queue_depth);
+    // false - "stdio" или fileName не обычный файл (канал, /dev/stdout): тогда только FILE*
+    static bool isUsable(const string& fileName);
+
+private:
+    int fd = -1;
+    // тот же файл с O_DIRECT, -1 - без него
+    int directFd = -1;
+};
+
+#endif //TESTPROJECT_BLOCK_IO_H
@@ -0,0 +1,62 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_BOUNDED_QUEUE_H
+#define TESTPROJECT_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+// Очередь фиксированной ёмкости между стадиями конвейера:
+// push блокируется, пока потребитель не освободит место,
+// pop возвращает false, когда очередь закрыта и пуста
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+
+    void push(T value) {
+        unique_lock<mutex> guard(lock);
+        notFull.wait(guard, [this]() { return items.size() < capacity || isClosed; });
+        if (isClosed) {
+            return;
+        }
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& value) {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [this]() { return !items.empty() || isClosed; });
+        if (items.empty()) {
+            return false;
+        }
+        value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // после close новые элементы не принимаются, оставшиеся можно дочитать
+    void close() {
+        lock_guard<mutex> guard(lock);
+        isClosed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    deque<T> items;
+    bool isClosed = false;
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+};
+
+#endif //TESTPROJECT_BOUNDED_QUEUE_H
@@ -0,0 +1,124 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include "args_parser.h"
+#include "server_protocol.h"
+
+using namespace std;
+
+namespace constants {
+    static string helpFlag = "--help";
+    static string socketParam = "--socket";
+    static string inputFileParam = "--input";
+    static string outputFileParam = "--output";
+    static string coefParam = "--coef";
+    static string shmFlag = "--shm";
+    static string statsFlag = "--stats";
+    static string shutdownFlag = "--shutdown";
+    static string defaultCoef = "0.00390625";
+}
+
+void printHelp() {
+    string output = "========= contrast_client =========\n";
+    output.append(constants::socketParam + " [path] - server socket (ContrastBalancer --serve [path])\n");
+    output.append(constants::inputFileParam + " [fname] - input image\n");
+    output.append(constants::outputFileParam + " [fname] - output image\n");
+    output.append(constants::coefParam + " [coef] - coefficient for ignoring not important colors (default 0.00390625)\n");
+    output.append(constants::shmFlag + " - pass the image through a memfd instead of file paths\n");
+    output.append(constants::statsFlag + " - print server counters\n");
+    output.append(constants::shutdownFlag + " - stop the server\n\n");
+    printf("%s", output.c_str());
+}
+
+// копирует size байт из in в out целиком, начиная с текущих позиций
+static bool copyAll(int out, int in, size_t size) {
+    while (size > 0) {
+        ssize_t copied = sendfile(out, in, nullptr, size);
+        if (copied <= 0) {
+            return false;
+        }
+        size -= size_t(copied);
+    }
+    return true;
+}
+
+// Изображение копируется в memfd, сервер растягивает его прямо в этих страницах,
+// результат копируется из memfd в выходной файл. Приложение, у которого кадр
+// уже в памяти, пишет его в memfd сразу и обходится без файлов
+static string processShared(const string& socketPath, const string& coeff, const string& input, const string& output) {
+    int in = open(input.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        throw runtime_error("Error while trying to open input file");
+    }
+    struct stat st{};
+    fstat(in, &st);
+
+    int memory = memfd_create("contrast_job", MFD_CLOEXEC);
+    if (memory < 0 || !copyAll(memory, in, size_t(st.st_size))) {
+        close(in);
+        if (memory >= 0) {
+            close(memory);
+        }
+        throw runtime_error("Error while trying to fill memfd");
+    }
+    close(in);
+
+    string reply = serverRequest(socketPath, "SHM " + coeff, memory);
+    if (reply.rfind("OK", 0) == 0) {
+        int out = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        lseek(memory, 0, SEEK_SET);
+        if (out < 0 || !copyAll(out, memory, size_t(st.st_size))) {
+            reply = "ERROR Error while trying to write to file";
+        }
+        if (out >= 0) {
+            close(out);
+        }
+    }
+    close(memory);
+    return reply;
+}
+
+int main(int argc, char* argv[]) {
+    map<string, string> argsMap = {};
+    parseArguments(argsMap, argc, argv);
+
+    const string& socketPath = argsMap[constants::socketParam];
+    if (argsMap[constants::helpFlag] == args_parser_constants::trueFlagValue || socketPath.empty()) {
+        printHelp();
+        return socketPath.empty() ? 1 : 0;
+    }
+
+    string coeff = argsMap[constants::coefParam].empty() ? constants::defaultCoef : argsMap[constants::coefParam];
+    string reply;
+    try {
+        if (argsMap[constants::statsFlag] == args_parser_constants::trueFlagValue) {
+            reply = serverRequest(socketPath, "STATS");
+        } else if (argsMap[constants::shutdownFlag] == args_parser_constants::trueFlagValue) {
+            reply = serverRequest(socketPath, "SHUTDOWN");
+        } else if (argsMap[constants::shmFlag] == args_parser_constants::trueFlagValue) {
+            reply = processShared(socketPath, coeff, argsMap[constants::inputFileParam], argsMap[constants::outputFileParam]);
+        } else {
+            // у сервера свой рабочий каталог - пути передаются абсолютными
+            string input = filesystem::absolute(argsMap[constants::inputFileParam]).string();
+            string output = filesystem::absolute(argsMap[constants::outputFileParam]).string();
+            reply = serverRequest(socketPath, "FILE " + coeff + "\n" + input + "\n" + output);
+        }
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    bool isOk = reply.rfind("OK", 0) == 0;
+    fprintf(isOk ? stdout : stderr, "%s\n", reply.c_str());
+    return isOk ? 0 : 1;
+}
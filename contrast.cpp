@@ -0,0 +1,125 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "contrast.h"
+#include "histogram.h"
+#include "histogram_reduction.h"
+#include "remap.h"
+#include "thread_pool.h"
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+static void checkView(const ImageView& view) {
+    if (view.data == nullptr || view.channels <= 0 || view.stride < view.rowBytes()) {
+        throw runtime_error("Invalid image view");
+    }
+}
+
+// тело получает строку и байтовый диапазон [begin, end) внутри неё
+typedef function<void(size_t, size_t, size_t, int)> RowRangeBody;
+
+// Сплошные виды делятся на static-куски как одна длинная строка - так же, как
+// data_size в modifyParallelCpp. Виды с отступами в конце строк делятся по строкам.
+// Один поток работает без пула - библиотечный вызов не создаёт общий пул зря
+static void forEachRowRange(bool isFlat, size_t height, size_t rowBytes, const int threads_count, const RowRangeBody& body) {
+    if (threads_count <= 1) {
+        if (isFlat) {
+            body(0, 0, height * rowBytes, 0);
+        } else {
+            for (size_t row = 0; row < height; row++) {
+                body(row, 0, rowBytes, 0);
+            }
+        }
+        return;
+    }
+
+    ThreadTeam pool = ThreadPool::shared(threads_count);
+    if (isFlat) {
+        pool.parallelFor(height * rowBytes, "static", 0, [&body](size_t start, size_t end, int thread_index) {
+            body(0, start, end, thread_index);
+        });
+    } else {
+        pool.parallelFor(height, "static", 0, [&body, rowBytes](size_t start, size_t end, int thread_index) {
+            for (size_t row = start; row < end; row++) {
+                body(row, 0, rowBytes, thread_index);
+            }
+        });
+    }
+}
+
+void contrastHistogram(const ImageView& view, size_t* elements, const int threads_count) {
+    checkView(view);
+
+    // сколько потоков реально даст пул: строки свёртки, раздача и свёртка - на одно это число
+    const int threadsCount = threads_count <= 1 ? 1 : ThreadPool::shared(threads_count).size();
+    HistogramReduction<size_t> reduction(threadsCount, 256);
+
+    const uchar* d = view.data;
+    const size_t stride = view.stride;
+    forEachRowRange(view.isContiguous(), view.height, view.rowBytes(), threadsCount,
+        [d, stride, &reduction](size_t row, size_t begin, size_t end, int thread_index) {
+            histogramAccumulate(d + row * stride + begin, end - begin, reduction.row(thread_index));
+        }
+    );
+
+    reduction.reduce(elements, threadsCount);
+}
+
+void contrastMinMax(const size_t* elements, size_t ignoreCount, uchar& min_v, uchar& max_v) noexcept {
+    size_t min_index = 255;
+    size_t max_index = 0;
+    determineMinMax(ignoreCount, elements, 256, min_index, max_index);
+    min_v = min_index;
+    max_v = max_index;
+}
+
+bool contrastBuildTable(uchar min_v, uchar max_v, uchar* table) noexcept {
+    // если уже растянуто или например 1 цвет - не делаем ничего
+    if ((min_v == 0 && max_v == 255) || min_v >= max_v) {
+        for (int v = 0; v < 256; v++) {
+            table[v] = uchar(v);
+        }
+        return false;
+    }
+    buildRemapTable(min_v, max_v, table);
+    return true;
+}
+
+void contrastApply(const ImageView& source, const ImageView& target, const uchar* table, const int threads_count) {
+    checkView(source);
+    checkView(target);
+    if (source.width != target.width || source.height != target.height || source.channels != target.channels) {
+        throw runtime_error("Source and target views differ in size");
+    }
+
+    const uchar* s = source.data;
+    uchar* d = target.data;
+    const size_t sourceStride = source.stride;
+    const size_t targetStride = target.stride;
+    forEachRowRange(source.isContiguous() && target.isContiguous(), source.height, source.rowBytes(), threads_count,
+        [s, d, sourceStride, targetStride, table](size_t row, size_t begin, size_t end, int) {
+            remapApply(s + row * sourceStride + begin, d + row * targetStride + begin, end - begin, table);
+        }
+    );
+}
+
+void contrastStretch(const ImageView& source, const ImageView& target, const float coeff, const int threads_count) {
+    size_t elements[256];
+    contrastHistogram(source, elements, threads_count);
+
+    uchar min_v;
+    uchar max_v;
+    contrastMinMax(elements, size_t(source.size() * coeff), min_v, max_v);
+
+    uchar table[256];
+    if (!contrastBuildTable(min_v, max_v, table) && source.data == target.data && source.stride == target.stride) {
+        return;
+    }
+    // нерастягиваемое изображение проходит через тождественную таблицу - это и есть копия
+    contrastApply(source, target, table, threads_count);
+}
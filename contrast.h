@@ -0,0 +1,55 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_CONTRAST_H
+#define TESTPROJECT_CONTRAST_H
+
+#include <cstddef>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Ядро libcontrast: то же растяжение, что и PNMPicture::modify*, но над чужим буфером
+// без копирования и без формата файла. C-интерфейс с теми же функциями - contrast_c.h
+
+// Несобственный вид на 8-битное изображение: height строк по stride байт,
+// в строке width пикселей по channels байт; хвост строки после width * channels не трогается
+struct ImageView {
+    uchar* data = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    size_t stride = 0;
+    int channels = 1;
+
+    size_t rowBytes() const noexcept { return width * size_t(channels); }
+    size_t size() const noexcept { return rowBytes() * height; }
+    // строки идут подряд - весь вид обрабатывается как один сплошной кусок
+    bool isContiguous() const noexcept { return stride == rowBytes(); }
+};
+
+// Все функции бросают runtime_error на некорректный вид (пустой указатель, stride < width * channels).
+// threads_count > 1 - работа идёт на первых threads_count потоках общего пула
+// ThreadPool::shared: он один на процесс, его размер задаётся один раз
+// (ThreadPool::configureShared, по умолчанию - число ядер) и больше не меняется,
+// а больше потоков, чем в пуле, вызов не получит. Вызовы из разных потоков безопасны -
+// пул выполняет их по очереди
+
+// гистограмма всех байтов вида в elements[0..256) (предыдущее содержимое затирается)
+void contrastHistogram(const ImageView& view, size_t* elements, const int threads_count);
+
+// границы растяжения, как в determineMinMax
+void contrastMinMax(const size_t* elements, size_t ignoreCount, uchar& min_v, uchar& max_v) noexcept;
+
+// таблица remap для [min_v, max_v]; false - растягивать нечего (уже растянуто или один цвет)
+bool contrastBuildTable(uchar min_v, uchar max_v, uchar* table) noexcept;
+
+// target = table[source]; виды одного размера, могут совпадать (растяжение на месте)
+void contrastApply(const ImageView& source, const ImageView& target, const uchar* table, const int threads_count);
+
+// всё вместе: гистограмма, границы с отбрасыванием coeff, таблица и apply
+// (если растягивать нечего - source копируется в target)
+void contrastStretch(const ImageView& source, const ImageView& target, const float coeff, const int threads_count);
+
+#endif //TESTPROJECT_CONTRAST_H
@@ -0,0 +1,79 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "contrast_c.h"
+#include "contrast.h"
+#include <exception>
+#include <stdexcept>
+
+using namespace std;
+
+static ImageView toView(const contrast_image_view* view) {
+    ImageView result;
+    result.data = view->data;
+    result.width = view->width;
+    result.height = view->height;
+    result.stride = view->stride;
+    result.channels = view->channels;
+    return result;
+}
+
+// исключения не должны пересекать границу C
+template <typename Body>
+static int guarded(Body body) noexcept {
+    try {
+        body();
+        return CONTRAST_OK;
+    } catch (runtime_error&) {
+        return CONTRAST_ERROR_INVALID_ARGUMENT;
+    } catch (...) {
+        return CONTRAST_ERROR_INTERNAL;
+    }
+}
+
+extern "C" {
+
+int contrast_abi_version(void) {
+    return CONTRAST_ABI_VERSION;
+}
+
+int contrast_histogram(const contrast_image_view* view, size_t* histogram, int threads_count) {
+    if (view == nullptr || histogram == nullptr) {
+        return CONTRAST_ERROR_INVALID_ARGUMENT;
+    }
+    return guarded([&]() { contrastHistogram(toView(view), histogram, threads_count); });
+}
+
+int contrast_min_max(const size_t* histogram, size_t ignore_count, unsigned char* min_v, unsigned char* max_v) {
+    if (histogram == nullptr || min_v == nullptr || max_v == nullptr) {
+        return CONTRAST_ERROR_INVALID_ARGUMENT;
+    }
+    contrastMinMax(histogram, ignore_count, *min_v, *max_v);
+    return CONTRAST_OK;
+}
+
+int contrast_build_table(unsigned char min_v, unsigned char max_v, unsigned char* table) {
+    if (table == nullptr) {
+        return CONTRAST_ERROR_INVALID_ARGUMENT;
+    }
+    return contrastBuildTable(min_v, max_v, table) ? CONTRAST_OK : 1;
+}
+
+int contrast_apply(const contrast_image_view* source, const contrast_image_view* target,
+                   const unsigned char* table, int threads_count) {
+    if (source == nullptr || target == nullptr || table == nullptr) {
+        return CONTRAST_ERROR_INVALID_ARGUMENT;
+    }
+    return guarded([&]() { contrastApply(toView(source), toView(target), table, threads_count); });
+}
+
+int contrast_stretch(const contrast_image_view* source, const contrast_image_view* target,
+                     float coeff, int threads_count) {
+    if (source == nullptr || target == nullptr || coeff < 0 || coeff >= 0.5) {
+        return CONTRAST_ERROR_INVALID_ARGUMENT;
+    }
+    return guarded([&]() { contrastStretch(toView(source), toView(target), coeff, threads_count); });
+}
+
+}
@@ -0,0 +1,57 @@
+/*
+ * Created by Igor Kluzhev on 17.10.2026.
+ */
+
+#ifndef TESTPROJECT_CONTRAST_C_H
+#define TESTPROJECT_CONTRAST_C_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Стабильный C-интерфейс libcontrast. Структуры меняются только добавлением полей
+   в конец с увеличением CONTRAST_ABI_VERSION; функции ничего не бросают, а возвращают код */
+
+#define CONTRAST_ABI_VERSION 1
+
+#define CONTRAST_OK 0
+#define CONTRAST_ERROR_INVALID_ARGUMENT (-1)
+#define CONTRAST_ERROR_INTERNAL (-2)
+
+/* несобственный вид на 8-битное изображение: height строк по stride байт,
+   в строке width пикселей по channels байт */
+typedef struct contrast_image_view {
+    unsigned char* data;
+    size_t width;
+    size_t height;
+    size_t stride;
+    int channels;
+} contrast_image_view;
+
+/* версия ABI собранной библиотеки - для проверки при динамической загрузке */
+int contrast_abi_version(void);
+
+/* гистограмма всех байтов вида в histogram[256] */
+int contrast_histogram(const contrast_image_view* view, size_t* histogram, int threads_count);
+
+/* границы растяжения с отбрасыванием ignore_count самых тёмных значений */
+int contrast_min_max(const size_t* histogram, size_t ignore_count, unsigned char* min_v, unsigned char* max_v);
+
+/* таблица remap на 256 значений; возвращает 1, если растягивать нечего (таблица тождественная) */
+int contrast_build_table(unsigned char min_v, unsigned char max_v, unsigned char* table);
+
+/* target = table[source]; виды одного размера, могут совпадать */
+int contrast_apply(const contrast_image_view* source, const contrast_image_view* target,
+                   const unsigned char* table, int threads_count);
+
+/* гистограмма, границы, таблица и apply за один вызов */
+int contrast_stretch(const contrast_image_view* source, const contrast_image_view* target,
+                     float coeff, int threads_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TESTPROJECT_CONTRAST_C_H */
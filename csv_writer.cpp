@@ -3,11 +3,17 @@
 //
 
 #include "csv_writer.h"
+#include "histogram.h"
+#include "remap.h"
 #include <string>
 
-CSVWriter::CSVWriter(string fileName) {
+CSVWriter::CSVWriter(string fileName, bool isBenchmark) {
     file.open(fileName);
-    file << "FILE;THREADS;KIND;SCHEDULE_KIND;CHUNK_SIZE;TIME" << endl;
+    if (isBenchmark) {
+        file << "IMAGE;BACKEND;THREADS;SCHEDULE_KIND;CHUNK_SIZE;REPETITIONS;MEDIAN_TIME;P95_TIME;MIN_TIME;GBPS;HISTOGRAM_KERNEL;HISTOGRAM_GBPS;REMAP_KERNEL" << endl;
+    } else {
+        file << "FILE;THREADS;KIND;SCHEDULE_KIND;CHUNK_SIZE;TIME;HISTOGRAM_KERNEL;HISTOGRAM_GBPS" << endl;
+    }
 }
 
 void CSVWriter::write(
@@ -18,7 +24,25 @@ void CSVWriter::write(
     string scheduleModifier,
     string scheduleKind,
     int chunkSize,
-    double time
+    double time,
+    double histogramGBps
 ) {
-    file << inputFileName << ";" << threadsCount << ";" << (isOmp ? "OMP" : "CPP") << ";" << (isCppOff ? "no-cpp" : scheduleKind) << ";" << (chunkSize == 0 ? to_string(-1) : to_string(chunkSize)) << ";" <<  time << endl;
+    file << inputFileName << ";" << threadsCount << ";" << (isOmp ? "OMP" : "CPP") << ";" << (isCppOff ? "no-cpp" : scheduleKind) << ";" << (chunkSize == 0 ? to_string(-1) : to_string(chunkSize)) << ";" <<  time << ";" << histogramKernelName() << ";" << histogramGBps << endl;
+}
+
+void CSVWriter::writeBenchmark(
+    string imageName,
+    string backend,
+    int threadsCount,
+    string scheduleKind,
+    int chunkSize,
+    int repetitions,
+    double medianTime,
+    double p95Time,
+    double minTime,
+    double gbps,
+    double histogramGBps
+) {
+    file << imageName << ";" << backend << ";" << threadsCount << ";" << scheduleKind << ";" << (chunkSize == 0 ? to_string(-1) : to_string(chunkSize)) << ";" << repetitions << ";"
+         << medianTime << ";" << p95Time << ";" << minTime << ";" << gbps << ";" << histogramKernelName() << ";" << histogramGBps << ";" << remapKernelName() << endl;
 }
\ No newline at end of file
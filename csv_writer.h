@@ -12,7 +12,8 @@ using namespace std;
 
 class CSVWriter {
 public:
-    explicit CSVWriter(string filename);
+    // isBenchmark = true - заголовок под writeBenchmark вместо write
+    explicit CSVWriter(string filename, bool isBenchmark = false);
 
     void write(
         string inputFileName,
@@ -22,7 +23,23 @@ public:
         string scheduleModifier,
         string scheduleKind,
         int chunkSize,
-        double time
+        double time,
+        double histogramGBps = 0
+    );
+
+    // одна точка сетки contrast_bench: статистика по repetitions замерам
+    void writeBenchmark(
+        string imageName,
+        string backend,
+        int threadsCount,
+        string scheduleKind,
+        int chunkSize,
+        int repetitions,
+        double medianTime,
+        double p95Time,
+        double minTime,
+        double gbps,
+        double histogramGBps
     );
 
 private:
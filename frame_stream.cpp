@@ -0,0 +1,148 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "frame_stream.h"
+#include "batch.h"
+#include "bounded_queue.h"
+#include "time_monitor.h"
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+// кадров в каждой очереди между стадиями - больше только добавляет задержку
+static constexpr size_t frameQueueDepth = 2;
+
+struct Frame {
+    unique_ptr<PNMPicture> picture;
+    size_t index = 0;
+    uchar min_v = 0;
+    uchar max_v = 0;
+    chrono::steady_clock::time_point arrival;
+};
+
+FrameStreamStats processFrameStream(
+    FILE* in,
+    FILE* out,
+    const float coeff,
+    const int threads_count,
+    const float smoothing,
+    const string& framesLog,
+    const vector<PointOp>& point_ops
+) {
+    if (smoothing <= 0 || smoothing > 1) {
+        throw runtime_error("Smoothing must be in range (0, 1]");
+    }
+    FILE* log = nullptr;
+    if (!framesLog.empty()) {
+        log = fopen(framesLog.c_str(), "w");
+        if (log == nullptr) {
+            throw runtime_error("Error while trying to open frames log");
+        }
+        fprintf(log, "FRAME;LATENCY_MS;MIN;MAX\n");
+    }
+
+    TimeMonitor::Phase framesPhase("frames");
+    const string readPath = TimeMonitor::currentPhasePath() + "/read";
+    const string writePath = TimeMonitor::currentPhasePath() + "/write";
+
+    PicturePool picturePool;
+    BoundedQueue<Frame> analyzedFrames(frameQueueDepth);
+    BoundedQueue<Frame> doneFrames(frameQueueDepth);
+    string readError;
+    string writeError;
+
+    FrameStreamStats stats;
+    auto start = chrono::steady_clock::now();
+
+    thread reader([&]() {
+        TimeMonitor::ThreadPhase threadPhase(readPath, 0);
+        for (size_t index = 0;; index++) {
+            // ждём первый байт кадра - время ожидания источника в задержку не входит
+            int first = fgetc(in);
+            if (first == EOF) {
+                break;
+            }
+            ungetc(first, in);
+
+            Frame frame;
+            frame.arrival = chrono::steady_clock::now();
+            frame.index = index;
+            frame.picture = picturePool.acquire();
+            frame.picture->pointOps = point_ops;
+            try {
+                frame.picture->readFrame(in);
+            } catch (exception& e) {
+                readError = "frame " + to_string(index) + ": " + e.what();
+                break;
+            }
+            frame.picture->analyzeFrame(coeff, frame.min_v, frame.max_v);
+            analyzedFrames.push(std::move(frame));
+        }
+        analyzedFrames.close();
+    });
+
+    thread writer([&]() {
+        TimeMonitor::ThreadPhase threadPhase(writePath, 0);
+        Frame frame;
+        while (doneFrames.pop(frame)) {
+            if (writeError.empty()) {
+                try {
+                    frame.picture->writeFrame(out);
+                    if (fflush(out) != 0) {
+                        throw runtime_error("Error while trying to write to file");
+                    }
+                } catch (exception& e) {
+                    writeError = "frame " + to_string(frame.index) + ": " + e.what();
+                }
+            }
+            double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - frame.arrival).count();
+            stats.latencies.push_back(latency);
+            if (log != nullptr) {
+                fprintf(log, "%zu;%lg;%d;%d\n", frame.index, latency, frame.min_v, frame.max_v);
+            }
+            picturePool.release(std::move(frame.picture));
+        }
+    });
+
+    // EMA по кадрам; первый кадр задаёт начальные значения
+    float smoothedMin = 0;
+    float smoothedMax = 0;
+    Frame frame;
+    while (analyzedFrames.pop(frame)) {
+        if (frame.index == 0) {
+            smoothedMin = frame.min_v;
+            smoothedMax = frame.max_v;
+        } else {
+            smoothedMin += smoothing * (float(frame.min_v) - smoothedMin);
+            smoothedMax += smoothing * (float(frame.max_v) - smoothedMax);
+        }
+        frame.min_v = uchar(lround(smoothedMin));
+        frame.max_v = uchar(lround(smoothedMax));
+
+        frame.picture->remapFrame(frame.min_v, frame.max_v, threads_count);
+        doneFrames.push(std::move(frame));
+    }
+    doneFrames.close();
+
+    reader.join();
+    writer.join();
+    if (log != nullptr) {
+        fclose(log);
+    }
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stats.framesCount = stats.latencies.size();
+
+    if (!readError.empty()) {
+        throw runtime_error(readError);
+    }
+    if (!writeError.empty()) {
+        throw runtime_error(writeError);
+    }
+    return stats;
+}
@@ -0,0 +1,39 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_FRAME_STREAM_H
+#define TESTPROJECT_FRAME_STREAM_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "point_ops.h"
+
+using namespace std;
+
+struct FrameStreamStats {
+    size_t framesCount = 0;
+    double seconds = 0;
+    // от появления первого байта кадра во входе до записи результата, мс
+    vector<double> latencies;
+};
+
+// Покадровая обработка последовательности PNM-кадров, записанных подряд (камера, ffmpeg -f image2pipe).
+// Три стадии: поток чтения читает кадр N + 1 и строит его гистограмму, пока текущий поток
+// растягивает кадр N на threads_count потоках пула, а поток записи отдаёт кадр N - 1.
+// smoothing из (0, 1] - коэффициент EMA для min_v/max_v между кадрами против мерцания,
+// 1 - без сглаживания. framesLog - CSV с задержкой и границами каждого кадра (пусто - не писать).
+// point_ops - операторы после растяжения каждого кадра (PNMPicture::pointOps)
+FrameStreamStats processFrameStream(
+    FILE* in,
+    FILE* out,
+    const float coeff,
+    const int threads_count,
+    const float smoothing,
+    const string& framesLog,
+    const vector<PointOp>& point_ops = {}
+);
+
+#endif //TESTPROJECT_FRAME_STREAM_H
@@ -0,0 +1,402 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "histogram.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HISTOGRAM_X86
+#endif
+
+using namespace std;
+
+// Наивный цикл elements[d[i]] += 1 упирается в store-to-load forwarding:
+// соседние пиксели фотографии почти всегда одного цвета и каждый инкремент
+// ждёт предыдущий. Поэтому считаем в 8 чередующихся подгистограмм -
+// байт k из каждого 8-байтового слова попадает в свою таблицу, - а в конце блока
+// складываем их. uint32 счётчики занимают 8 КБ и целиком лежат в L1.
+// Сами разнесённые по памяти инкременты не векторизуются, поэтому векторные ядра
+// ищут другое: однотонные участки. Вектор, все байты которого равны первому,
+// добавляется к таблице одним += ширина вектора вместо 16-64 инкрементов
+// одного и того же счётчика; остальные векторы считаются по словам, как в скалярном ядре.
+
+static constexpr int subHistogramsCount = 8;
+// однотонные векторы векторных ядер все идут в таблицу 0, так что в одну таблицу
+// за блок попадает не больше maxBlockSize значений - uint32 не переполнится
+static constexpr size_t maxBlockSize = size_t(1) << 30;
+
+typedef uint32_t SubHistograms[subHistogramsCount][256];
+
+static inline void countWord(SubHistograms& h, uint64_t w) noexcept {
+    h[0][w & 0xff] += 1;
+    h[1][(w >> 8) & 0xff] += 1;
+    h[2][(w >> 16) & 0xff] += 1;
+    h[3][(w >> 24) & 0xff] += 1;
+    h[4][(w >> 32) & 0xff] += 1;
+    h[5][(w >> 40) & 0xff] += 1;
+    h[6][(w >> 48) & 0xff] += 1;
+    h[7][w >> 56] += 1;
+}
+
+static inline void countTail(SubHistograms& h, const uchar* d, size_t size) noexcept {
+    for (size_t i = 0; i < size; i++) {
+        h[i % subHistogramsCount][d[i]] += 1;
+    }
+}
+
+static inline void mergeSubHistograms(const SubHistograms& h, size_t* elements) noexcept {
+    for (int i = 0; i < 256; i++) {
+        size_t sum = 0;
+        for (int j = 0; j < subHistogramsCount; j++) {
+            sum += h[j][i];
+        }
+        elements[i] += sum;
+    }
+}
+
+static size_t histogramBlockScalar(SubHistograms& h, const uchar* d, size_t size) noexcept {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint64_t w0, w1;
+        memcpy(&w0, d + i, 8);
+        memcpy(&w1, d + i + 8, 8);
+        countWord(h, w0);
+        countWord(h, w1);
+    }
+    return i;
+}
+
+#ifdef HISTOGRAM_X86
+
+// слова неоднотонного вектора берутся обычными загрузками из L1 - дешевле извлечения из регистра
+static inline void countWords(SubHistograms& h, const uchar* d, int wordsCount) noexcept {
+    for (int k = 0; k < wordsCount; k++) {
+        uint64_t w;
+        memcpy(&w, d + 8 * k, 8);
+        countWord(h, w);
+    }
+}
+
+__attribute__((target("sse2")))
+static size_t histogramBlockSse2(SubHistograms& h, const uchar* d, size_t size) noexcept {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(d + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(char(d[i])))) == 0xffff) {
+            h[0][d[i]] += 16;
+        } else {
+            countWords(h, d + i, 2);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t histogramBlockAvx2(SubHistograms& h, const uchar* d, size_t size) noexcept {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(d + i));
+        __m256i first = _mm256_broadcastb_epi8(_mm256_castsi256_si128(v));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, first)) == -1) {
+            h[0][d[i]] += 32;
+        } else {
+            countWords(h, d + i, 4);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t histogramBlockAvx512(SubHistograms& h, const uchar* d, size_t size) noexcept {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(d + i));
+        __m512i first = _mm512_broadcastb_epi8(_mm512_castsi512_si128(v));
+        if (_mm512_cmpeq_epi8_mask(v, first) == ~__mmask64(0)) {
+            h[0][d[i]] += 64;
+        } else {
+            countWords(h, d + i, 8);
+        }
+    }
+    return i;
+}
+
+#endif
+
+typedef size_t (*HistogramBlockKernel)(SubHistograms&, const uchar*, size_t) noexcept;
+
+struct HistogramKernel {
+    HistogramBlockKernel block;
+    const char* name;
+};
+
+static HistogramKernel selectKernel() noexcept {
+#ifdef HISTOGRAM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        return {histogramBlockAvx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {histogramBlockAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {histogramBlockSse2, "sse2"};
+    }
+#endif
+    return {histogramBlockScalar, "scalar"};
+}
+
+// выбирается один раз, при первом вызове
+static const HistogramKernel& kernel() noexcept {
+    static const HistogramKernel selected = selectKernel();
+    return selected;
+}
+
+static void accumulate(HistogramBlockKernel block, const uchar* d, size_t size, size_t* elements) noexcept {
+    // на совсем маленьких кусках (dynamic с chunk_size = 1) обнулять 8 КБ таблиц дороже самого подсчёта
+    if (size < 256) {
+        for (size_t i = 0; i < size; i++) {
+            elements[d[i]] += 1;
+        }
+        return;
+    }
+
+    SubHistograms h;
+
+    while (size > 0) {
+        size_t blockSize = size < maxBlockSize ? size : maxBlockSize;
+        memset(h, 0, sizeof(h));
+
+        size_t processed = block(h, d, blockSize);
+        countTail(h, d + processed, blockSize - processed);
+        mergeSubHistograms(h, elements);
+
+        d += blockSize;
+        size -= blockSize;
+    }
+}
+
+void histogramAccumulate(const uchar* d, size_t size, size_t* elements) noexcept {
+    accumulate(kernel().block, d, size, elements);
+}
+
+void histogramAccumulateRows(const uchar* d, size_t rowBytes, size_t rowsCount, size_t stride, size_t* elements) noexcept {
+    if (rowBytes * rowsCount < 256) {
+        for (size_t row = 0; row < rowsCount; row++) {
+            for (size_t i = 0; i < rowBytes; i++) {
+                elements[d[row * stride + i]] += 1;
+            }
+        }
+        return;
+    }
+
+    const HistogramBlockKernel block = kernel().block;
+    SubHistograms h;
+    memset(h, 0, sizeof(h));
+
+    // складываем, как только набрали maxBlockSize байт - в таблицу попало меньше
+    // 2^30 + rowBytes значений
+    size_t counted = 0;
+    for (size_t row = 0; row < rowsCount; row++) {
+        const uchar* r = d + row * stride;
+        size_t processed = block(h, r, rowBytes);
+        countTail(h, r + processed, rowBytes - processed);
+
+        counted += rowBytes;
+        if (counted >= maxBlockSize) {
+            mergeSubHistograms(h, elements);
+            memset(h, 0, sizeof(h));
+            counted = 0;
+        }
+    }
+    mergeSubHistograms(h, elements);
+}
+
+void histogramAccumulateScalar(const uchar* d, size_t size, size_t* elements) noexcept {
+    accumulate(histogramBlockScalar, d, size, elements);
+}
+
+// RGB: по две подгистограммы на канал - соседние пиксели чередуются между ними.
+// За 24 байта (8 пикселей) канал и подгистограмма каждого байта известны заранее
+static constexpr int rgbSubHistogramsCount = 6;
+static constexpr int rgbTableIndex[24] = {
+    0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5,
+    0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5,
+};
+
+typedef uint32_t RgbSubHistograms[rgbSubHistogramsCount][256];
+// 1 << 28 пикселей на блок - в одну подгистограмму попадёт не больше 2^27 значений
+static constexpr size_t maxBlockPixels = size_t(1) << 28;
+
+static inline void countRgb(RgbSubHistograms& h, const uchar* d, size_t size) noexcept {
+    size_t i = 0;
+    for (; i + 24 <= size; i += 24) {
+        for (int k = 0; k < 24; k++) {
+            h[rgbTableIndex[k]][d[i + k]] += 1;
+        }
+    }
+    for (; i < size; i++) {
+        h[i % 3][d[i]] += 1;
+    }
+}
+
+static inline void mergeRgbSubHistograms(const RgbSubHistograms& h, size_t* elements) noexcept {
+    for (int channel = 0; channel < 3; channel++) {
+        size_t* channelElements = elements + 256 * channel;
+        for (int v = 0; v < 256; v++) {
+            channelElements[v] += size_t(h[channel][v]) + h[channel + 3][v];
+        }
+    }
+}
+
+void histogramAccumulateRgb(const uchar* d, size_t pixelsCount, size_t* elements) noexcept {
+    RgbSubHistograms h;
+
+    while (pixelsCount > 0) {
+        size_t blockPixels = pixelsCount < maxBlockPixels ? pixelsCount : maxBlockPixels;
+        size_t blockSize = blockPixels * 3;
+        memset(h, 0, sizeof(h));
+
+        countRgb(h, d, blockSize);
+        mergeRgbSubHistograms(h, elements);
+
+        d += blockSize;
+        pixelsCount -= blockPixels;
+    }
+}
+
+void histogramAccumulateRgbRows(const uchar* d, size_t rowPixels, size_t rowsCount, size_t stride, size_t* elements) noexcept {
+    RgbSubHistograms h;
+    memset(h, 0, sizeof(h));
+
+    size_t counted = 0;
+    for (size_t row = 0; row < rowsCount; row++) {
+        countRgb(h, d + row * stride, rowPixels * 3);
+
+        counted += rowPixels;
+        if (counted >= maxBlockPixels) {
+            mergeRgbSubHistograms(h, elements);
+            memset(h, 0, sizeof(h));
+            counted = 0;
+        }
+    }
+    mergeRgbSubHistograms(h, elements);
+}
+
+// Старший байт 16-битного отсчёта - чётные байты; 4 подгистограммы по той же
+// причине, что и в histogramAccumulate
+typedef uint32_t SubHistograms16[4][256];
+// в одну подгистограмму за блок попадает не больше 2^28 отсчётов
+static constexpr size_t maxBlockSamples = size_t(1) << 30;
+
+void histogramAccumulateCoarse16(const uchar* d, size_t samplesCount, size_t* coarse) noexcept {
+    SubHistograms16 h;
+
+    while (samplesCount > 0) {
+        size_t blockSamples = samplesCount < maxBlockSamples ? samplesCount : maxBlockSamples;
+        memset(h, 0, sizeof(h));
+
+        size_t i = 0;
+        for (; i + 4 <= blockSamples; i += 4) {
+            h[0][d[2 * i]] += 1;
+            h[1][d[2 * i + 2]] += 1;
+            h[2][d[2 * i + 4]] += 1;
+            h[3][d[2 * i + 6]] += 1;
+        }
+        for (; i < blockSamples; i++) {
+            h[0][d[2 * i]] += 1;
+        }
+
+        for (int v = 0; v < 256; v++) {
+            coarse[v] += size_t(h[0][v]) + h[1][v] + h[2][v] + h[3][v];
+        }
+
+        d += 2 * blockSamples;
+        samplesCount -= blockSamples;
+    }
+}
+
+void histogramAccumulateFine16(
+    const uchar* d,
+    size_t samplesCount,
+    uchar lowBin,
+    uchar highBin,
+    size_t* fine
+) noexcept {
+    // без ветвлений: старший байт выбирает таблицу, отсчёты чужих корзин падают в таблицу 0
+    uchar slot[256] = {0};
+    slot[lowBin] = 1;
+    slot[highBin] = 2;
+    uint32_t h[3][256];
+
+    while (samplesCount > 0) {
+        size_t blockSamples = samplesCount < maxBlockSamples ? samplesCount : maxBlockSamples;
+        memset(h, 0, sizeof(h));
+
+        for (size_t i = 0; i < blockSamples; i++) {
+            h[slot[d[2 * i]]][d[2 * i + 1]] += 1;
+        }
+
+        for (int v = 0; v < 256; v++) {
+            fine[v] += h[1][v];
+            fine[256 + v] += h[2][v];
+        }
+
+        d += 2 * blockSamples;
+        samplesCount -= blockSamples;
+    }
+
+    if (lowBin == highBin) {
+        // обе границы в одной корзине - все её отсчёты ушли в таблицу 2
+        for (int v = 0; v < 256; v++) {
+            fine[v] = fine[256 + v];
+        }
+    }
+}
+
+// Тёмная граница - как и раньше: копим значения слева, пока не наберём ignoreCount,
+// и берём первую непустую корзину после этого. Светлая граница исторически
+// всегда была последней непустой корзиной - повторный проход в старом
+// determineMinMax затирал найденный с учётом ignoreCount индекс, - результат не меняется
+void determineMinMax(
+    size_t ignoreCount,
+    const size_t* elements,
+    size_t binsCount,
+    size_t& min_v,
+    size_t& max_v
+) noexcept {
+    size_t darkCount = 0;
+    for (size_t i = 0; i < binsCount; i++) {
+        size_t element = elements[i];
+        if (darkCount < ignoreCount) {
+            darkCount += element;
+        }
+
+        if (darkCount >= ignoreCount && element != 0) {
+            min_v = i;
+            break;
+        }
+    }
+
+    for (size_t i = binsCount; i > 0; i--) {
+        if (elements[i - 1] != 0) {
+            max_v = i - 1;
+            break;
+        }
+    }
+}
+
+const char* histogramKernelName() noexcept {
+    return kernel().name;
+}
+
+double throughputGBps(size_t bytes, chrono::steady_clock::time_point start) noexcept {
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (seconds <= 0) {
+        return 0;
+    }
+    return double(bytes) / seconds / 1e9;
+}
@@ -0,0 +1,67 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_HISTOGRAM_H
+#define TESTPROJECT_HISTOGRAM_H
+
+#include <cstddef>
+#include <chrono>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Добавляет гистограмму байтов d[0..size) к elements (256 счётчиков).
+// Реализация выбирается один раз при первом вызове по возможностям CPU:
+// AVX-512 / AVX2 / SSE2 / скалярная
+void histogramAccumulate(const uchar* d, size_t size, size_t* elements) noexcept;
+// то же всегда скалярной реализацией - для бэкенда scalar
+void histogramAccumulateScalar(const uchar* d, size_t size, size_t* elements) noexcept;
+
+// То же для прямоугольника: rowsCount строк по rowBytes байт с шагом stride.
+// Подгистограммы обнуляются и складываются один раз на весь прямоугольник,
+// а не на каждую строку - выгодно для узких тайлов
+void histogramAccumulateRows(const uchar* d, size_t rowBytes, size_t rowsCount, size_t stride, size_t* elements) noexcept;
+
+// То же для чередующихся RGB-пикселей: за один проход по pixelsCount * 3 байтам
+// добавляет гистограммы каналов к elements[0..256) (R), [256..512) (G), [512..768) (B)
+void histogramAccumulateRgb(const uchar* d, size_t pixelsCount, size_t* elements) noexcept;
+// RGB-прямоугольник: rowsCount строк по rowPixels пикселей с шагом stride байт
+void histogramAccumulateRgbRows(const uchar* d, size_t rowPixels, size_t rowsCount, size_t stride, size_t* elements) noexcept;
+
+// 16-битные отсчёты (big-endian, как в PNM с maxval > 255) считаются в два уровня,
+// чтобы не держать в каждом потоке 65536 счётчиков (512 КБ - мимо L1/L2 и дорогое слияние):
+// 1) грубая гистограмма по старшему байту - 256 корзин;
+// 2) точные гистограммы по младшему байту только для двух грубых корзин,
+//    в которые попали границы растяжения.
+// Каждому потоку хватает 256 + 2 * 256 счётчиков.
+void histogramAccumulateCoarse16(const uchar* d, size_t samplesCount, size_t* coarse) noexcept;
+// fine[0..256) - младшие байты отсчётов со старшим байтом lowBin,
+// fine[256..512) - со старшим байтом highBin
+void histogramAccumulateFine16(
+    const uchar* d,
+    size_t samplesCount,
+    uchar lowBin,
+    uchar highBin,
+    size_t* fine
+) noexcept;
+
+// Границы растяжения по гистограмме из binsCount корзин:
+// min_v - первая непустая корзина, на которой число значений слева достигает ignoreCount,
+// max_v - последняя непустая корзина
+void determineMinMax(
+    size_t ignoreCount,
+    const size_t* elements,
+    size_t binsCount,
+    size_t& min_v,
+    size_t& max_v
+) noexcept;
+
+// имя выбранной реализации - для логов и CSV
+const char* histogramKernelName() noexcept;
+
+// пропускная способность в ГБ/с для bytes байт, обработанных начиная с start
+double throughputGBps(size_t bytes, chrono::steady_clock::time_point start) noexcept;
+
+#endif //TESTPROJECT_HISTOGRAM_H
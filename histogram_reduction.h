@@ -0,0 +1,104 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_HISTOGRAM_REDUCTION_H
+#define TESTPROJECT_HISTOGRAM_REDUCTION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include "thread_pool.h"
+
+using namespace std;
+
+// Частичные гистограммы потоков и их свёртка без блокировок.
+// У каждого потока своя строка из bins корзин типа T; строки выровнены на линию кэша
+// и дополнены до целого числа линий, так что соседние потоки не делят линии
+// (нет false sharing ни при накоплении, ни при свёртке).
+// Свёртка идёт по столбцам: столбец - одна линия кэша корзин, его сумма по всем
+// строкам пишется в свою часть result. Столбцы не пересекаются - ни critical,
+// ни мьютексов, ни атомиков; на поток приходится bins / потоков столбцов по всем
+// строкам, поэтому время свёртки почти не растёт с числом потоков.
+// Маленькие свёртки (256 корзин на несколько потоков) дешевле сделать в одном
+// потоке, чем раздавать пулу, - см. reduce
+template <class T>
+class HistogramReduction {
+public:
+    static constexpr size_t cacheLineSize = 64;
+    static_assert(cacheLineSize % sizeof(T) == 0, "bin type must evenly divide a cache line");
+    static constexpr size_t lineBins = cacheLineSize / sizeof(T);
+
+    // все корзины сразу обнулены
+    HistogramReduction(size_t rows_count, size_t bins)
+        : rowsTotal(max<size_t>(rows_count, 1)),
+          binsTotal(bins),
+          rowStride((bins + lineBins - 1) / lineBins * lineBins),
+          storage(new (align_val_t(cacheLineSize)) T[rowsTotal * rowStride]()) {
+    }
+
+    HistogramReduction(const HistogramReduction&) = delete;
+    HistogramReduction& operator=(const HistogramReduction&) = delete;
+
+    size_t rowsCount() const noexcept { return rowsTotal; }
+    size_t binsCount() const noexcept { return binsTotal; }
+    size_t columnsCount() const noexcept { return rowStride / lineBins; }
+
+    // строка потока thread_index - в неё копит только он
+    T* row(size_t thread_index) noexcept { return storage.get() + thread_index * rowStride; }
+    const T* row(size_t thread_index) const noexcept { return storage.get() + thread_index * rowStride; }
+
+    void clear() noexcept {
+        fill(storage.get(), storage.get() + rowsTotal * rowStride, T(0));
+    }
+
+    // result[b] = сумма строк для корзин столбцов [begin, end); удобно звать из своей
+    // параллельной области (например, omp for по столбцам после накопления)
+    void reduceColumns(size_t begin, size_t end, T* result) const noexcept {
+        const size_t first = begin * lineBins;
+        const size_t last = min(end * lineBins, binsTotal);
+        if (first >= last) {
+            return;
+        }
+        const T* source = row(0);
+        copy(source + first, source + last, result + first);
+        for (size_t r = 1; r < rowsTotal; r++) {
+            source = row(r);
+            for (size_t b = first; b < last; b++) {
+                result[b] += source[b];
+            }
+        }
+    }
+
+    // вся свёртка в result[0..bins): большая - столбцами на пуле threads_count потоков
+    void reduce(T* result, const int threads_count) const {
+        if (threads_count <= 1 || rowsTotal * binsTotal < parallelReduceSize) {
+            reduceColumns(0, columnsCount(), result);
+            return;
+        }
+        ThreadPool::shared(threads_count).parallelFor(
+            columnsCount(), "static", 0,
+            [this, result](size_t begin, size_t end, int) {
+                reduceColumns(begin, end, result);
+            }
+        );
+    }
+
+private:
+    // меньше - один поток: раздача пулу стоит дороже самих сложений
+    static constexpr size_t parallelReduceSize = 1 << 16;
+
+    struct AlignedDelete {
+        void operator()(T* ptr) const noexcept {
+            ::operator delete[](ptr, align_val_t(cacheLineSize));
+        }
+    };
+
+    const size_t rowsTotal;
+    const size_t binsTotal;
+    const size_t rowStride;
+    unique_ptr<T[], AlignedDelete> storage;
+};
+
+#endif //TESTPROJECT_HISTOGRAM_REDUCTION_H
@@ -0,0 +1,133 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "image_buffer.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+static constexpr size_t hugePageSize = 2 << 20;
+// меньшие буферы трогает сам fread - будить ради них пул дороже
+// (в пакетном режиме мелкие файлы и так обрабатываются по одному на поток)
+static constexpr size_t parallelFirstTouchSize = 4 << 20;
+
+enum HugePagesMode {
+    hugePagesNone,
+    hugePagesTransparent,
+    hugePagesExplicit,
+};
+
+static atomic<int> hugePagesMode = hugePagesTransparent;
+static atomic<int> firstTouchThreads = 1;
+
+static size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool ImageBuffer::configure(const string& huge_pages, int threads_count) {
+    if (huge_pages == "none") {
+        hugePagesMode = hugePagesNone;
+    } else if (huge_pages == "transparent") {
+        hugePagesMode = hugePagesTransparent;
+    } else if (huge_pages == "explicit") {
+        hugePagesMode = hugePagesExplicit;
+    } else {
+        return false;
+    }
+    firstTouchThreads = max(threads_count, 1);
+    return true;
+}
+
+// анонимное отображение - ядро выдаёт страницы только при первом обращении,
+// поэтому своё заполнение нулями не нужно
+static uchar* allocate(size_t size, size_t& mappedSize) {
+    int mode = hugePagesMode.load(memory_order_relaxed);
+
+    if (mode == hugePagesExplicit) {
+        mappedSize = roundUp(size, hugePageSize);
+        void* mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapped != MAP_FAILED) {
+            return static_cast<uchar*>(mapped);
+        }
+        // в vm.nr_hugepages не хватило страниц
+        mode = hugePagesTransparent;
+    }
+
+    mappedSize = roundUp(size, size_t(sysconf(_SC_PAGESIZE)));
+    void* mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        throw runtime_error("Error while trying to allocate image buffer");
+    }
+    if (mode == hugePagesTransparent && mappedSize >= hugePageSize) {
+        madvise(mapped, mappedSize, MADV_HUGEPAGE);
+    }
+    return static_cast<uchar*>(mapped);
+}
+
+// Каждый поток пишет по байту в каждую страницу своего static-куска -
+// страница выделяется на узле этого потока.
+// Шаг - базовая страница и при huge pages: transparent-режим (и explicit, откатившийся
+// на него) не обещает 2 МБ страниц, и с шагом 2 МБ остальные страницы достались бы
+// тому потоку, что первым их прочитает. В уже выделенной huge page запись почти бесплатна
+static void firstTouch(uchar* ptr, size_t size) {
+    int threads = firstTouchThreads.load(memory_order_relaxed);
+    if (size < parallelFirstTouchSize || threads <= 1) {
+        return;
+    }
+
+    const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    ThreadPool::shared(threads).parallelFor(size, "static", 0, [ptr, pageSize](size_t start, size_t end, int) {
+        for (size_t i = roundUp(start, pageSize); i < end; i += pageSize) {
+            ptr[i] = 0;
+        }
+    });
+}
+
+ImageBuffer::~ImageBuffer() {
+    unmap();
+}
+
+ImageBuffer::ImageBuffer(ImageBuffer&& other) noexcept
+    : ptr(other.ptr), length(other.length), capacity(other.capacity) {
+    other.ptr = nullptr;
+    other.length = 0;
+    other.capacity = 0;
+}
+
+ImageBuffer& ImageBuffer::operator=(ImageBuffer&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        swap(ptr, other.ptr);
+        swap(length, other.length);
+        swap(capacity, other.capacity);
+    }
+    return *this;
+}
+
+void ImageBuffer::resize(size_t size) {
+    if (size > capacity) {
+        unmap();
+        if (size > 0) {
+            size_t mappedSize;
+            ptr = allocate(size, mappedSize);
+            capacity = mappedSize;
+            firstTouch(ptr, size);
+        }
+    }
+    length = size;
+}
+
+void ImageBuffer::unmap() noexcept {
+    if (ptr != nullptr) {
+        munmap(ptr, capacity);
+    }
+    ptr = nullptr;
+    length = 0;
+    capacity = 0;
+}
@@ -0,0 +1,62 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_IMAGE_BUFFER_H
+#define TESTPROJECT_IMAGE_BUFFER_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Буфер тела изображения вместо vector<uchar>:
+// - resize не заполняет память нулями - всё равно следом идёт fread или remap;
+// - память берётся через mmap, по возможности большими страницами;
+// - большие буферы заранее "трогаются" потоками общего пула по тому же static-разбиению,
+//   что и в modifyParallelCpp: каждая страница попадает на NUMA-узел потока,
+//   который потом будет её обрабатывать (при закреплённых потоках, см. ThreadPool::setPinning)
+class ImageBuffer {
+public:
+    ImageBuffer() = default;
+    ~ImageBuffer();
+
+    ImageBuffer(const ImageBuffer&) = delete;
+    ImageBuffer& operator=(const ImageBuffer&) = delete;
+    ImageBuffer(ImageBuffer&& other) noexcept;
+    ImageBuffer& operator=(ImageBuffer&& other) noexcept;
+
+    // содержимое после resize не определено; память перевыделяется,
+    // только если не хватает уже выделенной
+    void resize(size_t size);
+
+    uchar* data() noexcept { return ptr; }
+    const uchar* data() const noexcept { return ptr; }
+    size_t size() const noexcept { return length; }
+    bool empty() const noexcept { return length == 0; }
+
+    uchar* begin() noexcept { return ptr; }
+    uchar* end() noexcept { return ptr + length; }
+    const uchar* begin() const noexcept { return ptr; }
+    const uchar* end() const noexcept { return ptr + length; }
+
+    uchar& operator[](size_t i) noexcept { return ptr[i]; }
+    const uchar& operator[](size_t i) const noexcept { return ptr[i]; }
+
+    // huge_pages: "none", "transparent" (madvise, по умолчанию) или "explicit"
+    // (MAP_HUGETLB, при нехватке заранее выделенных страниц - как transparent);
+    // threads_count - сколько потоков пула делят первое касание.
+    // Возвращает false для неизвестного режима
+    static bool configure(const string& huge_pages, int threads_count);
+
+private:
+    void unmap() noexcept;
+
+    uchar* ptr = nullptr;
+    size_t length = 0;
+    size_t capacity = 0;
+};
+
+#endif //TESTPROJECT_IMAGE_BUFFER_H
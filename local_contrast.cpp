@@ -0,0 +1,264 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "local_contrast.h"
+#include "histogram.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+// веса смешивания - в 1/256
+static constexpr int weightOne = 256;
+
+// Для каждой координаты вдоль оси: два соседних тайла, между центрами которых
+// она лежит, и вес второго. До первого центра и после последнего - один крайний тайл
+struct AxisWeights {
+    vector<size_t> first;
+    vector<size_t> second;
+    vector<int> weight;
+};
+
+static vector<size_t> tileBounds(size_t length, size_t tiles) {
+    vector<size_t> bounds(tiles + 1);
+    for (size_t i = 0; i <= tiles; i++) {
+        bounds[i] = i * length / tiles;
+    }
+    return bounds;
+}
+
+static AxisWeights axisWeights(const vector<size_t>& bounds) {
+    const size_t tiles = bounds.size() - 1;
+    const size_t length = bounds[tiles];
+    vector<double> centers(tiles);
+    for (size_t i = 0; i < tiles; i++) {
+        centers[i] = double(bounds[i] + bounds[i + 1] - 1) / 2;
+    }
+
+    AxisWeights axis;
+    axis.first.resize(length);
+    axis.second.resize(length);
+    axis.weight.resize(length);
+
+    size_t tile = 0;
+    for (size_t p = 0; p < length; p++) {
+        while (tile + 1 < tiles && centers[tile + 1] <= double(p)) {
+            tile++;
+        }
+        if (double(p) <= centers[0] || tile + 1 == tiles) {
+            axis.first[p] = tile;
+            axis.second[p] = tile;
+            axis.weight[p] = 0;
+        } else {
+            double fraction = (double(p) - centers[tile]) / (centers[tile + 1] - centers[tile]);
+            axis.first[p] = tile;
+            axis.second[p] = tile + 1;
+            axis.weight[p] = int(lround(fraction * weightOne));
+        }
+    }
+    return axis;
+}
+
+// срез по clip_limit с равномерной раздачей излишка и нормированная кумулятивная сумма
+static void buildTileTable(size_t* elements, size_t total, const float clip_limit, uchar* table) noexcept {
+    if (clip_limit > 0) {
+        size_t limit = max<size_t>(1, size_t(double(clip_limit) * double(total) / 256));
+        size_t excess = 0;
+        for (int v = 0; v < 256; v++) {
+            if (elements[v] > limit) {
+                excess += elements[v] - limit;
+                elements[v] = limit;
+            }
+        }
+        const size_t perBin = excess / 256;
+        size_t rest = excess % 256;
+        for (int v = 0; v < 256; v++) {
+            elements[v] += perBin;
+        }
+        // остаток - по одному в корзины, равномерно разбросанные по диапазону
+        const size_t step = rest > 0 ? max<size_t>(256 / rest, 1) : 1;
+        for (size_t v = 0; v < 256 && rest > 0; v += step, rest--) {
+            elements[v] += 1;
+        }
+    }
+
+    size_t cdfMin = 0;
+    for (int v = 0; v < 256; v++) {
+        if (elements[v] != 0) {
+            cdfMin = elements[v];
+            break;
+        }
+    }
+    if (total <= cdfMin) {
+        // один цвет без среза - оставляем как есть
+        for (int v = 0; v < 256; v++) {
+            table[v] = uchar(v);
+        }
+        return;
+    }
+
+    const double scale = 255.0 / double(total - cdfMin);
+    size_t cdf = 0;
+    for (int v = 0; v < 256; v++) {
+        cdf += elements[v];
+        double value = (double(cdf) - double(cdfMin)) * scale;
+        table[v] = uchar(clamp(lround(value), 0L, 255L));
+    }
+}
+
+// отрезок строки между двумя центрами тайлов по x - таблицы на нём не меняются
+struct Span {
+    size_t begin;
+    size_t end;
+    size_t first;
+    size_t second;
+};
+
+// Channels = 0 - число каналов из channels_count
+template <int Channels>
+static void blendRow(
+    const uchar* s,
+    uchar* d,
+    const vector<Span>& spans,
+    const vector<int>& weightsX,
+    const uchar* tablesRow0,
+    const uchar* tablesRow1,
+    int weightY,
+    int channels_count
+) noexcept {
+    const int channels = Channels > 0 ? Channels : channels_count;
+    const size_t tableStride = size_t(channels) * 256;
+
+    for (const Span& span : spans) {
+        const uchar* t00 = tablesRow0 + span.first * tableStride;
+        const uchar* t01 = tablesRow0 + span.second * tableStride;
+        const uchar* t10 = tablesRow1 + span.first * tableStride;
+        const uchar* t11 = tablesRow1 + span.second * tableStride;
+
+        for (size_t x = span.begin; x < span.end; x++) {
+            const int weightX = weightsX[x];
+            for (int k = 0; k < channels; k++) {
+                const size_t i = x * channels + k;
+                const size_t index = size_t(k) * 256 + s[i];
+                const int a = t00[index];
+                const int b = t01[index];
+                const int c = t10[index];
+                const int e = t11[index];
+                const int top = (a << 8) + (b - a) * weightX;
+                const int bottom = (c << 8) + (e - c) * weightX;
+                d[i] = uchar(((top << 8) + (bottom - top) * weightY + (1 << 15)) >> 16);
+            }
+        }
+    }
+}
+
+// как forEachRowRange в contrast.cpp: один поток - без пула
+static void forEachIndex(size_t count, const string& schedule_kind, const int threads_count,
+                         const function<void(size_t, size_t)>& body) {
+    if (threads_count <= 1) {
+        body(0, count);
+        return;
+    }
+    ThreadPool::shared(threads_count).parallelFor(count, schedule_kind, 0, [&body](size_t start, size_t end, int) {
+        body(start, end);
+    });
+}
+
+void contrastLocal(
+    const ImageView& source,
+    const ImageView& target,
+    size_t tiles_x,
+    size_t tiles_y,
+    const float clip_limit,
+    const int threads_count
+) {
+    if (source.data == nullptr || target.data == nullptr || source.channels <= 0
+        || source.stride < source.rowBytes() || target.stride < target.rowBytes()) {
+        throw runtime_error("Invalid image view");
+    }
+    if (source.width != target.width || source.height != target.height || source.channels != target.channels) {
+        throw runtime_error("Source and target views differ in size");
+    }
+    if (source.width == 0 || source.height == 0) {
+        return;
+    }
+
+    tiles_x = clamp<size_t>(tiles_x, 1, source.width);
+    tiles_y = clamp<size_t>(tiles_y, 1, source.height);
+    const int channels = source.channels;
+    const size_t tableStride = size_t(channels) * 256;
+
+    const vector<size_t> boundsX = tileBounds(source.width, tiles_x);
+    const vector<size_t> boundsY = tileBounds(source.height, tiles_y);
+
+    // 1-3) гистограммы и таблицы тайлов; тайлы разного размера - dynamic
+    vector<uchar> tables(tiles_x * tiles_y * tableStride);
+    forEachIndex(tiles_x * tiles_y, "dynamic", threads_count, [&](size_t start, size_t end) {
+        vector<size_t> elements(tableStride);
+        for (size_t tile = start; tile < end; tile++) {
+            const size_t tileX = tile % tiles_x;
+            const size_t tileY = tile / tiles_x;
+            const size_t x0 = boundsX[tileX];
+            const size_t y0 = boundsY[tileY];
+            const size_t tileWidth = boundsX[tileX + 1] - x0;
+            const size_t tileHeight = boundsY[tileY + 1] - y0;
+            const uchar* d = source.data + y0 * source.stride + x0 * channels;
+
+            fill(elements.begin(), elements.end(), 0);
+            if (channels == 1) {
+                histogramAccumulateRows(d, tileWidth, tileHeight, source.stride, elements.data());
+            } else if (channels == 3) {
+                histogramAccumulateRgbRows(d, tileWidth, tileHeight, source.stride, elements.data());
+            } else {
+                for (size_t row = 0; row < tileHeight; row++) {
+                    for (size_t i = 0; i < tileWidth * channels; i++) {
+                        elements[(i % channels) * 256 + d[row * source.stride + i]] += 1;
+                    }
+                }
+            }
+
+            for (int k = 0; k < channels; k++) {
+                buildTileTable(elements.data() + k * 256, tileWidth * tileHeight, clip_limit,
+                               tables.data() + tile * tableStride + k * 256);
+            }
+        }
+    });
+
+    // 4) смешивание полосами строк
+    const AxisWeights axisX = axisWeights(boundsX);
+    const AxisWeights axisY = axisWeights(boundsY);
+
+    vector<Span> spans;
+    for (size_t x = 0; x < source.width; x++) {
+        if (spans.empty() || spans.back().first != axisX.first[x] || spans.back().second != axisX.second[x]) {
+            spans.push_back({x, x + 1, axisX.first[x], axisX.second[x]});
+        } else {
+            spans.back().end = x + 1;
+        }
+    }
+
+    const size_t tablesRowStride = tiles_x * tableStride;
+    forEachIndex(source.height, "static", threads_count, [&](size_t start, size_t end) {
+        for (size_t y = start; y < end; y++) {
+            const uchar* s = source.data + y * source.stride;
+            uchar* d = target.data + y * target.stride;
+            const uchar* tablesRow0 = tables.data() + axisY.first[y] * tablesRowStride;
+            const uchar* tablesRow1 = tables.data() + axisY.second[y] * tablesRowStride;
+            const int weightY = axisY.weight[y];
+
+            if (channels == 1) {
+                blendRow<1>(s, d, spans, axisX.weight, tablesRow0, tablesRow1, weightY, channels);
+            } else if (channels == 3) {
+                blendRow<3>(s, d, spans, axisX.weight, tablesRow0, tablesRow1, weightY, channels);
+            } else {
+                blendRow<0>(s, d, spans, axisX.weight, tablesRow0, tablesRow1, weightY, channels);
+            }
+        }
+    });
+}
@@ -0,0 +1,34 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_LOCAL_CONTRAST_H
+#define TESTPROJECT_LOCAL_CONTRAST_H
+
+#include <cstddef>
+#include "contrast.h"
+
+using namespace std;
+
+// Локальное растяжение в духе CLAHE для сцен с большим динамическим диапазоном,
+// где одна пара границ на всё изображение почти ничего не меняет.
+// 1) изображение делится на tiles_x * tiles_y тайлов, у каждого своя гистограмма
+//    по каждому каналу (histogramAccumulateRows / RgbRows), тайлы считаются параллельно;
+// 2) корзины выше clip_limit * (пикселей тайла / 256) срезаются, излишек делится
+//    поровну между всеми корзинами - так ограничивается усиление шума на ровных участках;
+//    clip_limit = 0 - без среза;
+// 3) таблица тайла - нормированная кумулятивная сумма срезанной гистограммы;
+// 4) каждый пиксель - билинейная смесь таблиц четырёх ближайших центров тайлов.
+//    Проход идёт полосами строк по потокам, внутри строки - отрезками между центрами
+//    тайлов, так что в L1 лежат только четыре таблицы текущего отрезка.
+// source и target одного размера и могут совпадать; бросает runtime_error на некорректный вид
+void contrastLocal(
+    const ImageView& source,
+    const ImageView& target,
+    size_t tiles_x,
+    size_t tiles_y,
+    const float clip_limit,
+    const int threads_count
+);
+
+#endif //TESTPROJECT_LOCAL_CONTRAST_H
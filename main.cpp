@@ -1,7 +1,22 @@
 #include <string>
 #include <map>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <sys/stat.h>
 #include "pnm.h"
+#include "backend.h"
+#include "autotune.h"
 #include "args_parser.h"
+#include "batch.h"
+#include "block_io.h"
+#include "frame_stream.h"
+#include "server.h"
+#include "shard.h"
+#include "tiled_image.h"
+#include "image_buffer.h"
+#include "thread_pool.h"
+#include "time_monitor.h"
 using namespace std;
 
 namespace constants {
@@ -9,7 +24,59 @@ namespace constants {
     static string outputFileParam = "--output";
     static string helpFlag = "--help";
     static string coefParam = "--coef";
+    static float defaultCoef = 0.00390625;
     static string deviceIndex = "device_index";
+    static string mmapFlag = "--mmap";
+    static string inPlaceFlag = "--inplace";
+    static string streamFlag = "--stream";
+    static string stripSizeParam = "--strip-size";
+    static size_t defaultStripSize = 4 << 20;
+    static string pipelineFlag = "--pipeline";
+    static string chunkSizeParam = "--chunk-size";
+    static string threadsParam = "--threads";
+    static size_t defaultPipelineChunkSize = 1 << 20;
+    static size_t pipelineQueueDepth = 8;
+    static string batchParam = "--batch";
+    static string outputDirParam = "--output-dir";
+    static size_t largeImageSize = 4 << 20;
+    static string profileParam = "--profile";
+    static string perChannelFlag = "--per-channel";
+    static string hugePagesParam = "--huge-pages";
+    static string defaultHugePages = "transparent";
+    static string pinParam = "--pin";
+    static string approxFlag = "--approx";
+    static string sampleSizeParam = "--sample-size";
+    static size_t defaultSampleSize = 1 << 24;
+    static string framesFlag = "--frames";
+    static string smoothingParam = "--smoothing";
+    static string framesLogParam = "--frames-log";
+    static string serveParam = "--serve";
+    static string defaultSocketPath = "/tmp/contrast.sock";
+    static string backendParam = "--backend";
+    static string defaultBackend = "auto";
+    static string autotuneFlag = "--autotune";
+    static string retuneFlag = "--retune";
+    static string tuneCacheParam = "--tune-cache";
+    static string localFlag = "--local";
+    static string tilesParam = "--tiles";
+    static size_t defaultTiles = 8;
+    static string clipLimitParam = "--clip-limit";
+    static float defaultClipLimit = 2;
+    static string ioParam = "--io";
+    static string defaultIo = "auto";
+    static string ioDirectFlag = "--io-direct";
+    static string ioDepthParam = "--io-depth";
+    static int defaultIoDepth = 8;
+    static string ioBlockParam = "--io-block";
+    static size_t defaultIoBlock = 1 << 20;
+    static string toTiledFlag = "--to-tiled";
+    static string fromTiledFlag = "--from-tiled";
+    static string tileSizeParam = "--tile-size";
+    static size_t defaultTileSize = 256;
+    static string regionParam = "--region";
+    static string tiledExtension = ".ctl";
+    static string shardsParam = "--shards";
+    static string opsParam = "--ops";
 }
 
 void printHelp() {
@@ -18,67 +85,667 @@ void printHelp() {
     output.append(constants::inputFileParam + " [fname] - input filename with pnm/ppm format\n");
     output.append(constants::outputFileParam + " [fname] - output file for modified image\n");
     output.append(constants::coefParam + " [coef] - coefficient for ignoring not important colors\n");
-    output.append(constants::deviceIndex + " [device_index] - index of selected CUDA device\n\n");
+    output.append(constants::deviceIndex + " [device_index] - index of selected CUDA device (default 0)\n");
+    output.append(constants::backendParam + " [" + backendNames() + "] - compute backend, auto takes the config cached by --autotune or --retune for the image size, otherwise all cores on threads with static schedule (default auto)\n");
+    output.append(constants::autotuneFlag + " - measure backends, threads, schedules and chunk sizes for every size class and cache the winners\n");
+    output.append(constants::retuneFlag + " - with --backend auto measure the size class of the input now and cache the winner\n");
+    output.append(constants::tuneCacheParam + " [fname] - autotune cache (default $XDG_CACHE_HOME or ~/.cache/contrast_autotune.csv)\n");
+    output.append(constants::opsParam + " [op,...] - pointwise operators after the stretch, fused into its table: gamma:g, invert, levels:low:high, threshold:t (levels and threshold in 0..255 scale)\n");
+    output.append(constants::localFlag + " - tiled CLAHE-style local contrast instead of one global stretch, " + constants::coefParam + " is ignored\n");
+    output.append(constants::tilesParam + " [WxH] - tiles grid for " + constants::localFlag + " (default 8x8)\n");
+    output.append(constants::clipLimitParam + " [limit] - histogram clip limit for " + constants::localFlag + " in multiples of the mean bin, 0 - no clipping (default 2)\n");
+    output.append(constants::toTiledFlag + " - convert P5/P6 input to a tiled " + constants::tiledExtension + " container with a histogram index\n");
+    output.append(constants::fromTiledFlag + " - convert a " + constants::tiledExtension + " container back to P5/P6\n");
+    output.append(constants::tileSizeParam + " [pixels] - tile side for " + constants::toTiledFlag + " (default 256)\n");
+    output.append(constants::regionParam + " [x,y,w,h] - for " + constants::tiledExtension + " input take bounds from the tiles covering this region\n");
+    output.append(constants::shardsParam + " [count] - split the image between this many worker processes, threads are divided between them\n");
+    output.append(constants::mmapFlag + " - read and write images through mmap without intermediate buffers, output equal to input is modified in place\n");
+    output.append(constants::inPlaceFlag + " - with " + constants::mmapFlag + " modifies input file in place, output is ignored\n");
+    output.append(constants::streamFlag + " - two-pass streaming mode for images larger than RAM\n");
+    output.append(constants::stripSizeParam + " [bytes] - strip size for " + constants::streamFlag + " (default 4 MiB)\n");
+    output.append(constants::pipelineFlag + " - overlap reading with histogram and remap with writing\n");
+    output.append(constants::chunkSizeParam + " [bytes] - chunk size for " + constants::pipelineFlag + " (default 1 MiB)\n");
+    output.append(constants::threadsParam + " [count] - worker threads count (default - all cores)\n");
+    output.append(constants::batchParam + " [dir|list|glob] - process many images, results go to " + constants::outputDirParam + "\n");
+    output.append(constants::outputDirParam + " [dir] - output directory for " + constants::batchParam + "\n");
+    output.append(constants::profileParam + " [fname] - phase profile as JSON (CSV for *.csv), without fname - JSON to stdout\n");
+    output.append(constants::perChannelFlag + " - stretch R, G and B channels of P6 images separately\n");
+    output.append(constants::ioParam + " [auto|uring|pread|stdio] - how image files are read and written, auto - io_uring if available, else pread (default auto)\n");
+    output.append(constants::ioDirectFlag + " - open image files with O_DIRECT, bypassing the page cache\n");
+    output.append(constants::ioDepthParam + " [count] - blocks in flight for " + constants::ioParam + " uring (default 8)\n");
+    output.append(constants::ioBlockParam + " [bytes] - I/O block size, multiple of 4096 (default 1 MiB)\n");
+    output.append(constants::hugePagesParam + " [none|transparent|explicit] - huge pages for image buffers (default transparent)\n");
+    output.append(constants::pinParam + " [none|cores|nodes] - pin worker threads to cores or NUMA nodes (default none)\n");
+    output.append(constants::approxFlag + " - estimate bounds from a random sample, exact histogram only when the sample is not conclusive; unlike the default mode it also drops --coef of the brightest values, so the result differs from the exact one\n");
+    output.append(constants::sampleSizeParam + " [count] - sample size for " + constants::approxFlag + " (default 16M)\n");
+    output.append(constants::framesFlag + " - process concatenated frames from stdin (or " + constants::inputFileParam + ") to stdout (or " + constants::outputFileParam + ")\n");
+    output.append(constants::smoothingParam + " [alpha] - EMA factor for min/max across frames, 1 - no smoothing (default 1)\n");
+    output.append(constants::framesLogParam + " [fname] - CSV with per-frame latency and bounds for " + constants::framesFlag + "\n");
+    output.append(constants::serveParam + " [socket] - run as a local server, jobs come from contrast_client (default /tmp/contrast.sock)\n\n");
     printf("%s", output.c_str());
 }
 
+// тот же файл под другим именем (путь, ссылка) - по устройству и inode
+static bool isSameFile(const string& first, const string& second) {
+    struct stat firstInfo, secondInfo;
+    return stat(first.c_str(), &firstInfo) == 0 && stat(second.c_str(), &secondInfo) == 0
+        && firstInfo.st_dev == secondInfo.st_dev && firstInfo.st_ino == secondInfo.st_ino;
+}
+
 int executeContrasting(
         string inputFileName,
         string outputFileName,
         float coeff,
-        int deviceIndex
+        int deviceIndex,
+        bool useMmap = false,
+        bool inPlace = false,
+        bool perChannel = false,
+        int threadsCount = 1,
+        size_t sampleSize = 0,
+        const string& backendName = constants::defaultBackend,
+        const string& tuneCachePath = "",
+        bool retune = false,
+        const vector<PointOp>& pointOps = {}
+) {
+    // до открытия выхода: mapOutput создаёт файл сразу, и после ошибки остался бы пустой выход
+    if (coeff < 0 || coeff >= 0.5) {
+        fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
+        return 1;
+    }
+
+    PNMPicture picture;
+    picture.asciiThreadsCount = threadsCount;
+    picture.pointOps = pointOps;
+    try {
+        if (useMmap) {
+            picture.readMapped(inputFileName, inPlace);
+            // P2/P3 уже разобраны в память - выход пишет write
+            if (!inPlace && !picture.isAscii()) {
+                if (isSameFile(inputFileName, outputFileName)) {
+                    // mapOutput обрезал бы ещё отображённый вход - тот же файл правится на месте
+                    picture.readMapped(inputFileName, true);
+                } else {
+                    picture.mapOutput(outputFileName);
+                }
+            }
+        } else {
+            picture.read(inputFileName);
+        }
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (perChannel) {
+        picture.modifyPerChannel(coeff, threadsCount);
+    } else if (sampleSize > 0) {
+        picture.modifyApproximate(coeff, threadsCount, sampleSize);
+    } else {
+        const ContrastBackend* backend = findBackend(backendName);
+        BackendOptions options;
+        options.threadsCount = threadsCount;
+        if (backendName == "auto") {
+            // конфигурация, найденная автотюнером для этой машины и размера тела
+            Autotuner tuner(tuneCachePath);
+            TunedConfig config = tuner.configFor(picture.data_size, threadsCount, retune);
+            backend = findBackend(config.backend);
+            options = config.options;
+        }
+        options.deviceIndex = deviceIndex;
+        backend->modify(picture, coeff, options);
+    }
+
+    if (useMmap && !picture.isAscii()) {
+        // результат уже лежит в отображённом файле
+        picture.closeMapped();
+        return 0;
+    }
+
+    try {
+        picture.write(outputFileName);
+    } catch (exception& e) {
+        fprintf(stderr, "%s", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int executeLocal(
+        string inputFileName,
+        string outputFileName,
+        size_t tilesX,
+        size_t tilesY,
+        float clipLimit,
+        int threadsCount
 ) {
+    if (tilesX == 0 || tilesY == 0 || clipLimit < 0) {
+        fprintf(stderr, "Error: tiles count must be positive and clip limit non-negative\n");
+        return 1;
+    }
+
     PNMPicture picture;
+    picture.asciiThreadsCount = threadsCount;
     try {
         picture.read(inputFileName);
+        picture.modifyLocal(tilesX, tilesY, clipLimit, threadsCount);
+        picture.write(outputFileName);
     } catch (exception& e) {
         fprintf(stderr, "%s\n", e.what());
         return 1;
     }
+    return 0;
+}
 
+static bool isTiledFile(const string& fileName) {
+    const string& extension = constants::tiledExtension;
+    return fileName.size() >= extension.size()
+        && fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+int executeTiledConversion(
+        string inputFileName,
+        string outputFileName,
+        bool toTiled,
+        size_t tileSize,
+        int threadsCount
+) {
+    PNMPicture picture;
+    picture.asciiThreadsCount = threadsCount;
+    try {
+        if (toTiled) {
+            picture.read(inputFileName);
+            tiledFromPicture(picture, outputFileName, tileSize, threadsCount);
+        } else {
+            TiledImage image;
+            image.open(inputFileName);
+            tiledToPicture(image, picture, threadsCount);
+            picture.write(outputFileName);
+        }
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// растяжение контейнера: границы - по индексу, выход - снова контейнер (.ctl) или P5/P6
+int executeTiled(
+        string inputFileName,
+        string outputFileName,
+        float coeff,
+        const TileRegion& region,
+        int threadsCount
+) {
     if (coeff < 0 || coeff >= 0.5) {
         fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
         return 1;
     }
 
-    picture.modifyParallelCUDA(coeff, deviceIndex);
-
     try {
+        if (isTiledFile(outputFileName)) {
+            tiledStretch(inputFileName, outputFileName, coeff, region, threadsCount);
+            return 0;
+        }
+        TiledImage image;
+        image.open(inputFileName);
+        uchar table[256];
+        tiledBuildTable(image, coeff, region, table);
+        PNMPicture picture;
+        tiledToPicture(image, picture, threadsCount, table);
         picture.write(outputFileName);
     } catch (exception& e) {
-        fprintf(stderr, "%s", e.what());
+        fprintf(stderr, "%s\n", e.what());
         return 1;
     }
     return 0;
 }
 
-int pseudoMain(int argc, char* argv[]) {
-    map<string, string> argsMap = {};
-    parseArguments(argsMap, argc, argv);
+int executeSharded(
+        string inputFileName,
+        string outputFileName,
+        float coeff,
+        int shardsCount,
+        int threadsCount,
+        const vector<string>& workerArgs
+) {
+    if (coeff < 0 || coeff >= 0.5) {
+        fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
+        return 1;
+    }
+    if (shardsCount <= 0) {
+        fprintf(stderr, "Error: shards count must be positive\n");
+        return 1;
+    }
 
-    if (argsMap[constants::helpFlag] == args_parser_constants::trueFlagValue && argc == 2) {
-        printHelp();
-        return 0;
+    try {
+        shardedStretch(inputFileName, outputFileName, coeff, shardsCount, max(threadsCount / shardsCount, 1),
+                       workerArgs);
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
     }
+    return 0;
+}
 
-    if (argc < 7 || argc > 9) {
+int executeStreaming(
+        string inputFileName,
+        string outputFileName,
+        float coeff,
+        size_t stripSize,
+        const vector<PointOp>& pointOps
+) {
+    if (coeff < 0 || coeff >= 0.5) {
+        fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
+        return 1;
+    }
+
+    PNMPicture picture;
+    picture.pointOps = pointOps;
+    try {
+        picture.modifyStreaming(inputFileName, outputFileName, coeff, stripSize);
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int executePipelined(
+        string inputFileName,
+        string outputFileName,
+        float coeff,
+        int threadsCount,
+        size_t chunkSize,
+        const vector<PointOp>& pointOps
+) {
+    if (coeff < 0 || coeff >= 0.5) {
+        fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
+        return 1;
+    }
+
+    PNMPicture picture;
+    picture.pointOps = pointOps;
+    try {
+        picture.modifyPipelined(inputFileName, outputFileName, coeff, threadsCount, chunkSize, constants::pipelineQueueDepth);
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int executeBatch(
+        string source,
+        string outputDir,
+        float coeff,
+        int threadsCount,
+        const vector<PointOp>& pointOps
+) {
+    if (coeff < 0 || coeff >= 0.5) {
+        fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
+        return 1;
+    }
+
+    BatchStats stats;
+    try {
+        vector<string> inputs = collectBatchInputs(source);
+        stats = processBatch(inputs, outputDir, coeff, threadsCount, constants::largeImageSize, pointOps);
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    double seconds = max(stats.seconds, 1e-9);
+    printf("Processed %zu images (%zu failed) in %lg s: %lg images/s, %lg MB/s\n",
+           stats.imagesCount, stats.failedCount, stats.seconds,
+           double(stats.imagesCount) / seconds, double(stats.bytesCount) / seconds / 1e6);
+    return stats.failedCount == 0 ? 0 : 1;
+}
+
+static double percentile(vector<double> values, double p) {
+    sort(values.begin(), values.end());
+    size_t index = size_t(ceil(p * double(values.size()))) - 1;
+    return values[min(index, values.size() - 1)];
+}
+
+int executeFrames(
+        string inputFileName,
+        string outputFileName,
+        float coeff,
+        int threadsCount,
+        float smoothing,
+        string framesLog,
+        const vector<PointOp>& pointOps
+) {
+    if (coeff < 0 || coeff >= 0.5) {
+        fprintf(stderr, "Error: coeff must be in range [0, 0.5)\n");
+        return 1;
+    }
+
+    FILE* in = inputFileName.empty() ? stdin : fopen(inputFileName.c_str(), "rb");
+    FILE* out = outputFileName.empty() ? stdout : fopen(outputFileName.c_str(), "wb");
+    if (in == nullptr || out == nullptr) {
+        fprintf(stderr, "Error while trying to open frames input or output\n");
+        return 1;
+    }
+
+    int result = 0;
+    FrameStreamStats stats;
+    try {
+        stats = processFrameStream(in, out, coeff, threadsCount, smoothing, framesLog, pointOps);
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        result = 1;
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    // stdout занят кадрами - отчёт в stderr
+    if (stats.framesCount > 0) {
+        double sum = 0;
+        for (double latency : stats.latencies) {
+            sum += latency;
+        }
+        fprintf(stderr, "Processed %zu frames in %lg s: %lg fps, latency mean %lg ms, p50 %lg ms, p95 %lg ms, max %lg ms\n",
+                stats.framesCount, stats.seconds, double(stats.framesCount) / max(stats.seconds, 1e-9),
+                sum / double(stats.framesCount), percentile(stats.latencies, 0.5),
+                percentile(stats.latencies, 0.95), percentile(stats.latencies, 1));
+    }
+    return result;
+}
+
+int executeAutotune(const string& tuneCachePath) {
+    try {
+        Autotuner tuner(tuneCachePath);
+        vector<TunedConfig> configs = tuner.tuneAll();
+        for (int size_class = 0; size_class < int(configs.size()); size_class++) {
+            const TunedConfig& config = configs[size_class];
+            printf("~%zu KB: %s threads=%d %s chunk=%d, %lg GB/s\n", Autotuner::sizeClassSample(size_class) >> 10,
+                   config.backend.c_str(), config.options.threadsCount, config.options.scheduleKind.c_str(),
+                   config.options.chunkSize, config.gbps);
+        }
+        printf("Saved to %s\n", tuner.cachePath().c_str());
+    } catch (exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+void writeProfile(const string& profileOutput) {
+    if (profileOutput == args_parser_constants::trueFlagValue) {
+        TimeMonitor::writeProfileJson(stdout);
+        return;
+    }
+
+    FILE* out = fopen(profileOutput.c_str(), "w");
+    if (out == nullptr) {
+        fprintf(stderr, "Error while trying to open profile output file\n");
+        return;
+    }
+    bool isCsv = profileOutput.size() >= 4 && profileOutput.compare(profileOutput.size() - 4, 4, ".csv") == 0;
+    if (isCsv) {
+        TimeMonitor::writeProfileCsv(out);
+    } else {
+        TimeMonitor::writeProfileJson(out);
+    }
+    fclose(out);
+}
+
+int executeCommand(map<string, string>& argsMap, int argc) {
+    // кадры по умолчанию идут через stdin/stdout - входной и выходной файлы необязательны
+    bool isFrames = argsMap[constants::framesFlag] == args_parser_constants::trueFlagValue;
+    bool isServer = !argsMap[constants::serveParam].empty();
+    bool isAutotune = argsMap[constants::autotuneFlag] == args_parser_constants::trueFlagValue;
+    // у пакетного режима свои обязательные флаги - проверяются ниже
+    bool isBatch = !argsMap[constants::batchParam].empty();
+    // процесс-рабочий шардированного режима (shard.h): только сокет и настройки координатора
+    bool isShardWorker = !argsMap[shard_constants::workerFlag].empty();
+    // локальному режиму и преобразованиям контейнера коэффициент не нужен
+    bool isLocal = argsMap[constants::localFlag] == args_parser_constants::trueFlagValue;
+    bool isToTiled = argsMap[constants::toTiledFlag] == args_parser_constants::trueFlagValue;
+    bool isFromTiled = argsMap[constants::fromTiledFlag] == args_parser_constants::trueFlagValue;
+    bool isCoefUnused = isLocal || isToTiled || isFromTiled;
+    if (argc < (isCoefUnused ? 6 : 7) && !isFrames && !isServer && !isAutotune && !isBatch && !isShardWorker) {
         fprintf(stderr, "Incorrect number of arguments, see help with --help");
         return 1;
     }
 
+    int threadsCount = int(thread::hardware_concurrency());
+    if (!parseNumericArgument(argsMap, constants::threadsParam, threadsCount)) {
+        return 1;
+    }
+    threadsCount = max(threadsCount, 1);
+
+    string hugePages = argsMap[constants::hugePagesParam];
+    if (!ImageBuffer::configure(hugePages.empty() ? constants::defaultHugePages : hugePages, threadsCount)) {
+        fprintf(stderr, "Unsupported huge pages mode %s\n", hugePages.c_str());
+        return 1;
+    }
+    string ioKind = argsMap[constants::ioParam].empty() ? constants::defaultIo : argsMap[constants::ioParam];
+    int ioDepth = constants::defaultIoDepth;
+    size_t ioBlock = constants::defaultIoBlock;
+    if (!parseNumericArgument(argsMap, constants::ioDepthParam, ioDepth)
+        || !parseNumericArgument(argsMap, constants::ioBlockParam, ioBlock)) {
+        return 1;
+    }
+    bool ioDirect = argsMap[constants::ioDirectFlag] == args_parser_constants::trueFlagValue;
+    if (!BlockFile::configure(ioKind, ioDirect, ioBlock, ioDepth)) {
+        fprintf(stderr, "Unsupported I/O kind %s\n", ioKind.c_str());
+        return 1;
+    }
+    string pinKind = argsMap[constants::pinParam];
+    if (!pinKind.empty() && !ThreadPool::setPinning(pinKind)) {
+        fprintf(stderr, "Unsupported pinning kind %s\n", pinKind.c_str());
+        return 1;
+    }
+    // общий пул - один на процесс и с закреплением выше; --threads ограничивает
+    // только число потоков каждого вызова, автотюнеру остаются все ядра
+    ThreadPool::configureShared(max(threadsCount, int(thread::hardware_concurrency())));
+
+    if (isShardWorker) {
+        int socket = -1;
+        if (!parseNumericArgument(argsMap, shard_constants::workerFlag, socket)) {
+            return 1;
+        }
+        return runShardWorker(socket);
+    }
+
+    // операторы сворачиваются в таблицу растяжения; у локального режима, контейнера
+    // и шардов своих таблиц нет
+    string opsSpec = argsMap[constants::opsParam];
+    vector<PointOp> pointOps;
+    if (!opsSpec.empty()) {
+        if (isCoefUnused || !argsMap[constants::shardsParam].empty() || isTiledFile(argsMap[constants::inputFileParam])) {
+            fprintf(stderr, "%s is not supported with %s, %s and tiled containers\n", constants::opsParam.c_str(),
+                    constants::localFlag.c_str(), constants::shardsParam.c_str());
+            return 1;
+        }
+        try {
+            pointOps = parsePointOps(opsSpec);
+        } catch (exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+
+    if (isAutotune) {
+        return executeAutotune(argsMap[constants::tuneCacheParam]);
+    }
+
+    if (isServer) {
+        string socketPath = argsMap[constants::serveParam];
+        if (socketPath == args_parser_constants::trueFlagValue) {
+            socketPath = constants::defaultSocketPath;
+        }
+        try {
+            return runServer(socketPath, threadsCount, constants::largeImageSize, pointOps);
+        } catch (exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+
+    float coeff = constants::defaultCoef;
+    if (!parseNumericArgument(argsMap, constants::coefParam, coeff)) {
+        return 1;
+    }
+
+    if (isBatch) {
+        for (const string* param : {&constants::batchParam, &constants::outputDirParam}) {
+            const string& value = argsMap[*param];
+            if (value.empty() || value == args_parser_constants::trueFlagValue) {
+                fprintf(stderr, "Missing value for %s, see help with --help\n", param->c_str());
+                return 1;
+            }
+        }
+        return executeBatch(argsMap[constants::batchParam], argsMap[constants::outputDirParam], coeff, threadsCount, pointOps);
+    }
+
     string inputFileName = argsMap[constants::inputFileParam];
     string outputFilename = argsMap[constants::outputFileParam];
-    int deviceIndex = stoi(argsMap[constants::deviceIndex]);
-    float coeff = stof(argsMap[constants::coefParam]);
 
-    return executeContrasting(inputFileName, outputFilename, coeff, deviceIndex);
+    if (isFrames) {
+        float smoothing = 1;
+        if (!parseNumericArgument(argsMap, constants::smoothingParam, smoothing)) {
+            return 1;
+        }
+        return executeFrames(inputFileName, outputFilename, coeff, threadsCount, smoothing,
+                             argsMap[constants::framesLogParam], pointOps);
+    }
+
+    if (isToTiled || isFromTiled) {
+        size_t tileSize = constants::defaultTileSize;
+        if (!parseNumericArgument(argsMap, constants::tileSizeParam, tileSize)) {
+            return 1;
+        }
+        return executeTiledConversion(inputFileName, outputFilename, isToTiled, tileSize, threadsCount);
+    }
+
+    if (isTiledFile(inputFileName)) {
+        TileRegion region;
+        string regionValue = argsMap[constants::regionParam];
+        if (!regionValue.empty()
+            && sscanf(regionValue.c_str(), "%zu,%zu,%zu,%zu", &region.x, &region.y, &region.width, &region.height) != 4) {
+            fprintf(stderr, "Region must be x,y,w,h\n");
+            return 1;
+        }
+        return executeTiled(inputFileName, outputFilename, coeff, region, threadsCount);
+    }
+
+    if (isLocal) {
+        size_t tilesX = constants::defaultTiles;
+        size_t tilesY = constants::defaultTiles;
+        string tiles = argsMap[constants::tilesParam];
+        if (!tiles.empty()) {
+            size_t separator = tiles.find('x');
+            bool isParsed = separator == string::npos
+                ? parseNumber(tiles, tilesX) && parseNumber(tiles, tilesY)
+                : parseNumber(tiles.substr(0, separator), tilesX) && parseNumber(tiles.substr(separator + 1), tilesY);
+            if (!isParsed) {
+                fprintf(stderr, "Incorrect value for %s\n", constants::tilesParam.c_str());
+                return 1;
+            }
+        }
+        float clipLimit = constants::defaultClipLimit;
+        if (!parseNumericArgument(argsMap, constants::clipLimitParam, clipLimit)) {
+            return 1;
+        }
+        return executeLocal(inputFileName, outputFilename, tilesX, tilesY, clipLimit, threadsCount);
+    }
+
+    if (!argsMap[constants::shardsParam].empty()) {
+        int shardsCount = 0;
+        if (!parseNumericArgument(argsMap, constants::shardsParam, shardsCount)) {
+            return 1;
+        }
+        // рабочие - отдельные процессы: настройки ввода-вывода, памяти и закрепления
+        // уходят им в командной строке
+        vector<string> workerArgs;
+        for (const string& name : {constants::hugePagesParam, constants::ioParam, constants::ioDirectFlag,
+                                   constants::ioDepthParam, constants::ioBlockParam, constants::pinParam}) {
+            if (!argsMap[name].empty()) {
+                workerArgs.push_back(name);
+                workerArgs.push_back(argsMap[name]);
+            }
+        }
+        return executeSharded(inputFileName, outputFilename, coeff, shardsCount, threadsCount, workerArgs);
+    }
+
+    if (argsMap[constants::streamFlag] == args_parser_constants::trueFlagValue) {
+        size_t stripSize = constants::defaultStripSize;
+        if (!parseNumericArgument(argsMap, constants::stripSizeParam, stripSize)) {
+            return 1;
+        }
+        return executeStreaming(inputFileName, outputFilename, coeff, stripSize, pointOps);
+    }
+
+    if (argsMap[constants::pipelineFlag] == args_parser_constants::trueFlagValue) {
+        size_t chunkSize = constants::defaultPipelineChunkSize;
+        if (!parseNumericArgument(argsMap, constants::chunkSizeParam, chunkSize)) {
+            return 1;
+        }
+        return executePipelined(inputFileName, outputFilename, coeff, threadsCount, chunkSize, pointOps);
+    }
+
+    int deviceIndex = 0;
+    if (!parseNumericArgument(argsMap, constants::deviceIndex, deviceIndex)) {
+        return 1;
+    }
+    string backendName = argsMap[constants::backendParam].empty() ? constants::defaultBackend
+                                                                  : argsMap[constants::backendParam];
+    if (backendName != "auto") {
+        const ContrastBackend* backend = findBackend(backendName);
+        if (backend == nullptr) {
+            fprintf(stderr, "Unsupported backend %s, expected %s\n", backendName.c_str(), backendNames().c_str());
+            return 1;
+        }
+        if (!backend->isAvailable()) {
+            fprintf(stderr, "Backend %s is not available on this machine\n", backendName.c_str());
+            return 1;
+        }
+    }
+    bool useMmap = argsMap[constants::mmapFlag] == args_parser_constants::trueFlagValue;
+    bool inPlace = argsMap[constants::inPlaceFlag] == args_parser_constants::trueFlagValue;
+    bool perChannel = argsMap[constants::perChannelFlag] == args_parser_constants::trueFlagValue;
+    size_t sampleSize = 0;
+    if (argsMap[constants::approxFlag] == args_parser_constants::trueFlagValue) {
+        sampleSize = constants::defaultSampleSize;
+        if (!parseNumericArgument(argsMap, constants::sampleSizeParam, sampleSize)) {
+            return 1;
+        }
+    }
+
+    bool retune = argsMap[constants::retuneFlag] == args_parser_constants::trueFlagValue;
+    return executeContrasting(inputFileName, outputFilename, coeff, deviceIndex, useMmap, inPlace, perChannel,
+                              threadsCount, sampleSize, backendName, argsMap[constants::tuneCacheParam], retune,
+                              pointOps);
 }
 
-int main(int argc, char* argv[]) {
-//    return pseudoMain(argc, argv);
+int pseudoMain(int argc, char* argv[]) {
+    map<string, string> argsMap = {};
+    parseArguments(argsMap, argc, argv);
+
+    if (argsMap[constants::helpFlag] == args_parser_constants::trueFlagValue && argc == 2) {
+        printHelp();
+        return 0;
+    }
+
+    string profileOutput = argsMap[constants::profileParam];
+    TimeMonitor::enableProfiling(!profileOutput.empty());
 
-    fprintf(stdout, "Starting\n");
-    auto result = executeContrasting("in.ppm", "out.ppm", 0.00390625, 0);
-    fprintf(stdout, "Ending\n");
+    int result = executeCommand(argsMap, argc);
+
+    if (!profileOutput.empty()) {
+        writeProfile(profileOutput);
+    }
     return result;
+}
+
+int main(int argc, char* argv[]) {
+    return pseudoMain(argc, argv);
 }
\ No newline at end of file
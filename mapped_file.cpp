@@ -0,0 +1,84 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "mapped_file.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::openRead(const string& fileName, bool writable) {
+    close();
+
+    int fileFd = open(fileName.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fileFd < 0) {
+        throw runtime_error("Error while trying to open input file");
+    }
+    openDescriptor(fileFd, writable);
+}
+
+void MappedFile::openDescriptor(int fileFd, bool writable) {
+    close();
+    fd = fileFd;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close();
+        throw runtime_error("Error while trying to read file");
+    }
+    length = st.st_size;
+
+    int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    int flags = writable ? MAP_SHARED : MAP_PRIVATE;
+    void* mapped = mmap(nullptr, length, prot, flags, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close();
+        throw runtime_error("Error while trying to map input file");
+    }
+    ptr = static_cast<uchar*>(mapped);
+
+    // данные проходим один раз от начала к концу - просим ядро читать с опережением
+    madvise(ptr, length, MADV_SEQUENTIAL);
+}
+
+void MappedFile::create(const string& fileName, size_t size) {
+    close();
+
+    fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Error while trying to open output file");
+    }
+
+    if (ftruncate(fd, off_t(size)) != 0) {
+        close();
+        throw runtime_error("Error while trying to resize output file");
+    }
+    length = size;
+
+    void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close();
+        throw runtime_error("Error while trying to map output file");
+    }
+    ptr = static_cast<uchar*>(mapped);
+}
+
+void MappedFile::close() noexcept {
+    if (ptr != nullptr) {
+        munmap(ptr, length);
+        ptr = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+}
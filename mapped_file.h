@@ -0,0 +1,44 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_MAPPED_FILE_H
+#define TESTPROJECT_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// RAII-обёртка над mmap: файл целиком отображается в память,
+// чтение/запись идут напрямую в page cache без промежуточных буферов
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // writable = true -> MAP_SHARED, изменения попадают в сам файл
+    void openRead(const string& fileName, bool writable);
+    // то же для уже открытого дескриптора (например, memfd от клиента сервера);
+    // дескриптор переходит во владение MappedFile
+    void openDescriptor(int fileFd, bool writable);
+    // создаёт (или обрезает) файл нужного размера и отображает его на запись
+    void create(const string& fileName, size_t size);
+    void close() noexcept;
+
+    uchar* data() const noexcept { return ptr; }
+    size_t size() const noexcept { return length; }
+    bool isOpen() const noexcept { return ptr != nullptr; }
+
+private:
+    int fd = -1;
+    uchar* ptr = nullptr;
+    size_t length = 0;
+};
+
+#endif //TESTPROJECT_MAPPED_FILE_H
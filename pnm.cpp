@@ -3,12 +3,27 @@
 //
 
 #include "pnm.h"
+#include "pnm_ascii.h"
+#include "histogram.h"
+#include "remap.h"
+#include "quantile.h"
+#include "contrast.h"
+#include "local_contrast.h"
+#include "point_ops.h"
+#include "block_io.h"
+#include "bounded_queue.h"
+#include "histogram_reduction.h"
+#include "thread_pool.h"
+#include "time_monitor.h"
 #include <omp.h>
 #include <cmath>
+#include <cstdint>
 #include <stdio.h>
+#include <cstring>
 #include <stdexcept>
 #include <thread>
-#include <mutex>
+#include <atomic>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -27,33 +42,98 @@ PNMPicture::~PNMPicture() {
 };
 
 void PNMPicture::read(const string& fileName) {
+    TimeMonitor::Phase phase("read");
+    if (BlockFile::isUsable(fileName)) {
+        readBlocks(fileName);
+        return;
+    }
+
     fin = fopen(fileName.c_str(), "rb");
     if (fin == nullptr) {
         throw runtime_error("Error while trying to open input file");
     }
 
+    readHeader();
+
+    read();
+    fclose(fin);
+    fin = nullptr;
+}
+
+void PNMPicture::readHeader() {
+    TimeMonitor::Phase phase("header");
     char p;
     char binChar;
     fscanf(fin, "%c%i%c%d %d%c%d%c", &p, &format, &binChar, &width, &height, &binChar, &colors, &binChar);
 
     if (p != 'P')
         throw runtime_error("Unsupported format input file");
+}
 
-    read();
-    fclose(fin);
-    fin = nullptr;
+size_t PNMPicture::parseHeader(const uchar* buffer, size_t length) {
+    TimeMonitor::Phase phase("header");
+    // sscanf ищет конец строки, поэтому заголовок копируем в буфер с нулём на конце
+    char header[64] = {0};
+    memcpy(header, buffer, min(length, sizeof(header) - 1));
+
+    char p = 0;
+    char binChar;
+    int headerSize = 0;
+    sscanf(header, "%c%i%c%d %d%c%d%c%n", &p, &format, &binChar, &width, &height, &binChar, &colors, &binChar, &headerSize);
+
+    if (p != 'P' || headerSize == 0)
+        throw runtime_error("Unsupported format input file");
+    return headerSize;
 }
 
-void PNMPicture::read() {
-    if (format == 5) {
+void PNMPicture::determineChannels() {
+    if (format == 2 || format == 5) {
         channelsCount = 1;
-    } else if (format == 6) {
+    } else if (format == 3 || format == 6) {
         channelsCount = 3;
     } else {
         throw runtime_error("Unsupported format of PNM file");
     }
-    data_size = width * height * channelsCount;
+    if (colors <= 0 || colors > 65535) {
+        throw runtime_error("Unsupported maxval of PNM file");
+    }
+    bytesPerSample = colors > 255 ? 2 : 1;
+    data_size = size_t(width) * height * channelsCount * bytesPerSample;
+}
+
+void PNMPicture::read() {
+    TimeMonitor::Phase phase("body");
+
+    determineChannels();
     data.resize(data_size);
+    isHistogramParsed = false;
+
+    if (isAscii()) {
+        // длина текста заранее неизвестна: для обычного файла берём остаток по fstat,
+        // для канала - удваиваем буфер, пока fread не вернёт меньше запрошенного
+        vector<char> text;
+        struct stat info;
+        size_t expectedLength = size_t(1) << 20;
+        off_t bodyOffset = ftello(fin);
+        if (fstat(fileno(fin), &info) == 0 && S_ISREG(info.st_mode) && bodyOffset >= 0 && info.st_size > bodyOffset) {
+            expectedLength = size_t(info.st_size - bodyOffset);
+        }
+        text.resize(expectedLength + 1);
+
+        size_t length = 0;
+        while (true) {
+            length += fread(text.data() + length, 1, text.size() - length, fin);
+            if (length < text.size()) {
+                break;
+            }
+            text.resize(text.size() * 2);
+        }
+        if (ferror(fin)) {
+            throw runtime_error("Error while trying to read file");
+        }
+        parseAsciiBody(text.data(), length);
+        return;
+    }
 
     const size_t bytesRead = fread(data.data(), 1, data_size, fin);
 
@@ -62,7 +142,173 @@ void PNMPicture::read() {
     }
 }
 
+size_t PNMPicture::probe(const string& fileName) {
+    BlockFile file;
+    file.openRead(fileName);
+    uchar header[64];
+    const size_t headerLength = min(file.size(), sizeof(header));
+    file.read(header, headerLength, 0);
+    const size_t headerSize = parseHeader(header, headerLength);
+    determineChannels();
+    return headerSize;
+}
+
+// заголовок - из первых байт файла, как у readMapped, тело - блоками в data
+void PNMPicture::readBlocks(const string& fileName) {
+    BlockFile file;
+    file.openRead(fileName);
+    const size_t fileSize = file.size();
+    uchar header[64];
+    const size_t headerLength = min(fileSize, sizeof(header));
+    file.read(header, headerLength, 0);
+    const size_t headerSize = parseHeader(header, headerLength);
+
+    TimeMonitor::Phase phase("body");
+    determineChannels();
+    data.resize(data_size);
+    isHistogramParsed = false;
+
+    if (isAscii()) {
+        vector<char> text(fileSize - headerSize);
+        file.read((uchar*)text.data(), text.size(), headerSize);
+        parseAsciiBody(text.data(), text.size());
+        return;
+    }
+
+    if (fileSize < headerSize + data_size) {
+        throw runtime_error("Error while trying to read file");
+    }
+    file.read(data.data(), data_size, headerSize);
+}
+
+void PNMPicture::readMapped(const string& fileName, bool inPlace) {
+    TimeMonitor::Phase phase("read");
+    closeMapped();
+    inputMapping.openRead(fileName, inPlace);
+    attachInputMapping(inPlace);
+}
+
+void PNMPicture::readMapped(int fd) {
+    TimeMonitor::Phase phase("read");
+    closeMapped();
+    inputMapping.openDescriptor(fd, true);
+    attachInputMapping(true);
+}
+
+void PNMPicture::attachInputMapping(bool inPlace) {
+    inputHeaderSize = parseHeader(inputMapping.data(), inputMapping.size());
+    determineChannels();
+    isHistogramParsed = false;
+
+    if (isAscii()) {
+        if (inPlace) {
+            closeMapped();
+            throw runtime_error("ASCII PNM cannot be modified in place");
+        }
+        // текст разбирается прямо из отображения, дальше картинка живёт в data,
+        // как после обычного read
+        data.resize(data_size);
+        parseAsciiBody((const char*)inputMapping.data() + inputHeaderSize, inputMapping.size() - inputHeaderSize);
+        closeMapped();
+        return;
+    }
+
+    if (inputMapping.size() < inputHeaderSize + data_size) {
+        closeMapped();
+        throw runtime_error("Error while trying to read file");
+    }
+    isMapped = true;
+    isInPlace = inPlace;
+}
+
+void PNMPicture::parseAsciiBody(const char* text, size_t length) {
+    // у 8-битных отсчётов гистограмма копится заодно с разбором
+    size_t* elements = nullptr;
+    if (bytesPerSample == 1) {
+        histogram.assign(256, 0);
+        elements = histogram.data();
+    }
+    asciiParse(text, length, data.data(), data_size / bytesPerSample, bytesPerSample, colors,
+               asciiThreadsCount, elements);
+    isHistogramParsed = elements != nullptr;
+}
+
+bool PNMPicture::isAscii() const noexcept {
+    return format == 2 || format == 3;
+}
+
+bool PNMPicture::takeParsedHistogram() noexcept {
+    bool isParsed = isHistogramParsed;
+    isHistogramParsed = false;
+    return isParsed;
+}
+
+void PNMPicture::mapOutput(const string& fileName) {
+    if (isAscii()) {
+        // длина текста станет известна только при форматировании
+        throw runtime_error("ASCII PNM output cannot be mapped");
+    }
+    char header[64];
+    int headerSize = snprintf(header, sizeof(header), "P%d\n%d %d\n%d\n", format, width, height, colors);
+
+    outputMapping.create(fileName, headerSize + data_size);
+    memcpy(outputMapping.data(), header, headerSize);
+}
+
+void PNMPicture::closeMapped() noexcept {
+    inputMapping.close();
+    outputMapping.close();
+    inputHeaderSize = 0;
+    isMapped = false;
+    isInPlace = false;
+}
+
+const uchar* PNMPicture::sourceData() const noexcept {
+    if (isMapped) {
+        return inputMapping.data() + inputHeaderSize;
+    }
+    return data.data();
+}
+
+uchar* PNMPicture::targetData() noexcept {
+    // тело сейчас будет перезаписано
+    isHistogramParsed = false;
+    if (outputMapping.isOpen()) {
+        return outputMapping.data() + (outputMapping.size() - data_size);
+    }
+    if (isMapped && isInPlace) {
+        return inputMapping.data() + inputHeaderSize;
+    }
+    if (isMapped && data.size() != data_size) {
+        // отображение только на чтение и выходной файл не отображён - результат копим в куче
+        data.resize(data_size);
+    }
+    return data.data();
+}
+
+// вызывается, когда изображение уже растянуто и remap пропускается:
+// выход всё равно должен содержать исходные пиксели
+void PNMPicture::copyThrough() noexcept {
+    const uchar* s = sourceData();
+    uchar* d = targetData();
+    if (s != d) {
+        memcpy(d, s, data_size);
+    }
+}
+
 void PNMPicture::write(const string& fileName) {
+    TimeMonitor::Phase phase("write");
+
+    // длина текста P2/P3 известна только после форматирования - он идёт через FILE*
+    if (!isAscii() && BlockFile::isUsable(fileName)) {
+        char header[64];
+        int headerSize = snprintf(header, sizeof(header), "P%d\n%d %d\n%d\n", format, width, height, colors);
+        BlockFile file;
+        file.create(fileName);
+        file.writeAll((const uchar*)header, headerSize, targetData(), data_size);
+        return;
+    }
+
     fout = fopen(fileName.c_str(), "wb");
     if (fout == nullptr) {
         throw runtime_error("Error while trying to open output file");
@@ -76,14 +322,76 @@ void PNMPicture::write(const string& fileName) {
 void PNMPicture::write() {
     fprintf(fout, "P%d\n%d %d\n%d\n", format, width, height, colors);
 
-    size_t dataSize = width * height * channelsCount;
-    const size_t writtenBytes = fwrite(data.data(), 1, dataSize, fout);
+    if (isAscii()) {
+        asciiWrite(fout, targetData(), data_size / bytesPerSample, bytesPerSample, colors, asciiThreadsCount);
+        return;
+    }
+
+    const size_t writtenBytes = fwrite(targetData(), 1, data_size, fout);
 
-    if (writtenBytes != dataSize) {
+    if (writtenBytes != data_size) {
         throw runtime_error("Error while trying to write to file");
     }
 }
 
+void PNMPicture::readFrame(FILE* in) {
+    fin = in;
+    try {
+        readHeader();
+        if (isAscii()) {
+            // конец текстового кадра не найти без разбора - кадры только двоичные
+            throw runtime_error("ASCII PNM is not supported in frame stream mode");
+        }
+        read();
+    } catch (...) {
+        fin = nullptr;
+        throw;
+    }
+    fin = nullptr;
+    if (bytesPerSample != 1) {
+        throw runtime_error("16-bit samples are not supported in frame stream mode");
+    }
+}
+
+void PNMPicture::writeFrame(FILE* out) {
+    fout = out;
+    try {
+        write();
+    } catch (...) {
+        fout = nullptr;
+        throw;
+    }
+    fout = nullptr;
+}
+
+void PNMPicture::analyzeFrame(const float coeff, uchar& min_v, uchar& max_v) noexcept {
+    size_t ignoreCount = data_size * coeff;
+    min_v = 255;
+    max_v = 0;
+
+    auto histogramStart = chrono::steady_clock::now();
+    analyzeData(histogram);
+    histogramGBps = throughputGBps(data_size, histogramStart);
+
+    determineMinMax(ignoreCount, histogram, min_v, max_v);
+}
+
+void PNMPicture::remapFrame(uchar min_v, uchar max_v, const int threads_count) noexcept {
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
+        return;
+    }
+
+    TimeMonitor::Phase remapPhase("remap");
+
+    const uchar* s = sourceData();
+    uchar* d = targetData();
+    ThreadPool::shared(threads_count).parallelFor(data_size, "static", 0, [s, d, &table](size_t start, size_t end, int) {
+        remapApply(s + start, d + start, end - start, table);
+    });
+}
+
 // 1) изначально при итерировании собираем кол-ва по каждому цвету
 // 2) при итерировании по цветам суммируем кол-во для тёмных и светлых
 // 3) при достижении нужного кол-ва - идём дальше
@@ -92,92 +400,172 @@ void PNMPicture::write() {
 // 5) пробегаемся ещё раз и меняем значения
 // доступные методы: omp + simd + ilp
 
+// Однопоточный путь - обёртка над ядром libcontrast (contrast.h):
+// тело изображения передаётся как несобственный вид без копирования
 void PNMPicture::modify(const float coeff) noexcept {
-    if (data_size == 1) {
+    if (bytesPerSample != 1) {
+        modifyWide(coeff, 1, "static", 0);
+        return;
+    }
+    TimeMonitor::Phase modifyPhase("modify");
+
+    if (data_size <= 1) {
+        copyThrough();
         return;
     }
 
     size_t ignoreCount = data_size * coeff;
-    vector<size_t> elements;
+    vector<size_t>& elements = histogram;
+    elements.resize(256);
     uchar min_v = 255;
     uchar max_v = 0;
 
-    analyzeData(elements);
-    determineMinMax(ignoreCount, elements, min_v, max_v);
+    const ImageView source = bodyView(const_cast<uchar*>(sourceData()));
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+        if (!takeParsedHistogram()) {
+            contrastHistogram(source, elements.data(), 1);
+        }
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+    {
+        TimeMonitor::Phase phase("minmax");
+        contrastMinMax(elements.data(), ignoreCount, min_v, max_v);
+    }
 
     // если уже растянуто - не делаем ничего
     // или если например 1 цвет - не делаем ничего
-    if ((min_v == 0 && max_v == 255) || min_v >= max_v) {
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
         return;
     }
 
-    float const scale = 255 / float(max_v - min_v);
-    float scaledMinV = scale * float(min_v);
+    TimeMonitor::Phase remapPhase("remap");
+    contrastApply(source, bodyView(targetData()), table, 1);
+}
 
-    uchar* d = data.data();
-    for (size_t i = 0; i < data_size; i++) {
-        int scaledValue1 = scale * d[i] - scaledMinV;
-        d[i] = max(0, min(scaledValue1, 255));
+void PNMPicture::modifyScalar(const float coeff) noexcept {
+    if (bytesPerSample != 1) {
+        modifyWide(coeff, 1, "static", 0);
+        return;
     }
-}
+    TimeMonitor::Phase modifyPhase("modify");
 
-void PNMPicture::modifyParallelCUDA(const float coeff, const int threads_count) noexcept {
-    if (data_size == 1) {
+    if (data_size <= 1) {
+        copyThrough();
         return;
     }
 
     size_t ignoreCount = data_size * coeff;
-    vector<size_t> elements;
+    vector<size_t>& elements = histogram;
     uchar min_v = 255;
     uchar max_v = 0;
 
-    analyzeDataParallelCUDA(elements, threads_count);
-    determineMinMax(ignoreCount, elements, min_v, max_v);
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+        if (!takeParsedHistogram()) {
+            elements.assign(256, 0);
+            histogramAccumulateScalar(sourceData(), data_size, elements.data());
+        }
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+    {
+        TimeMonitor::Phase phase("minmax");
+        determineMinMax(ignoreCount, elements, min_v, max_v);
+    }
 
-    // если уже растянуто - не делаем ничего
-    // или если например 1 цвет - не делаем ничего
-    if ((min_v == 0 && max_v == 255) || min_v >= max_v) {
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
         return;
     }
 
-    float const scale = 255 / float(max_v - min_v);
-    float scaledMinV = scale * float(min_v);
+    TimeMonitor::Phase remapPhase("remap");
+    const uchar* s = sourceData();
+    uchar* d = targetData();
+    remapApplyScalar(s, d, data_size, table);
+}
 
-    uchar* d = data.data();
-#pragma omp parallel for schedule(runtime) num_threads(threads_count)
-    for (size_t i = 0; i < data_size; i++) {
-        int scaledValue = int(scale * float(d[i]) - scaledMinV);
-        d[i] = max(0, min(scaledValue, 255));
-    }
+ImageView PNMPicture::bodyView(uchar* d) const noexcept {
+    ImageView view;
+    view.data = d;
+    view.width = size_t(width);
+    view.height = size_t(height);
+    view.channels = channelsCount;
+    view.stride = view.rowBytes();
+    return view;
 }
 
+// omp for с schedule(runtime) раздаёт не отдельные байты, а блоки по
+// parallelBlockSize - внутри блока работают векторные ядра гистограммы и remap
+static constexpr size_t parallelBlockSize = 64 * 1024;
+
+#ifndef CONTRAST_WITH_CUDA
+void PNMPicture::modifyParallelCUDA(const float coeff, const int /*device_index*/) noexcept {
+    // номер устройства - не число потоков; запасной путь тот же, что при ошибках CUDA в pnm.cu
+    modify(coeff);
+}
+#endif
+
 void PNMPicture::modifyParallelOmp(const float coeff, const int threads_count) noexcept {
+    if (bytesPerSample != 1) {
+        modifyWide(coeff, threads_count, "static", 0);
+        return;
+    }
+    TimeMonitor::Phase modifyPhase("modify");
+
     if (data_size == 1) {
+        copyThrough();
         return;
     }
 
     size_t ignoreCount = data_size * coeff;
-    vector<size_t> elements;
+    vector<size_t>& elements = histogram;
     uchar min_v = 255;
     uchar max_v = 0;
 
-    analyzeDataParallelOmp(elements, threads_count);
-    determineMinMax(ignoreCount, elements, min_v, max_v);
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+        if (!takeParsedHistogram()) {
+            analyzeDataParallelOmp(elements, threads_count);
+        }
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+    {
+        TimeMonitor::Phase phase("minmax");
+        determineMinMax(ignoreCount, elements, min_v, max_v);
+    }
 
     // если уже растянуто - не делаем ничего
     // или если например 1 цвет - не делаем ничего
-    if ((min_v == 0 && max_v == 255) || min_v >= max_v) {
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
         return;
     }
 
-    float const scale = 255 / float(max_v - min_v);
-    float scaledMinV = scale * float(min_v);
+    TimeMonitor::Phase remapPhase("remap");
+
+    const uchar* s = sourceData();
+    uchar* d = targetData();
+    const size_t blocksCount = (data_size + parallelBlockSize - 1) / parallelBlockSize;
 
-    uchar* d = data.data();
-#pragma omp parallel for schedule(runtime) num_threads(threads_count)
-    for (size_t i = 0; i < data_size; i++) {
-        int scaledValue = int(scale * float(d[i]) - scaledMinV);
-        d[i] = max(0, min(scaledValue, 255));
+    const string phasePath = TimeMonitor::currentPhasePath();
+
+#pragma omp parallel num_threads(threads_count)
+    {
+        TimeMonitor::ThreadPhase threadPhase(phasePath, omp_get_thread_num());
+
+#pragma omp for schedule(runtime)
+        for (size_t block = 0; block < blocksCount; block++) {
+            size_t start = block * parallelBlockSize;
+            size_t end = min(start + parallelBlockSize, data_size);
+            remapApply(s + start, d + start, end - start, table);
+        }
     }
 }
 
@@ -187,232 +575,652 @@ void PNMPicture::modifyParallelCpp(
     const string schedule_kind,
     const int chunk_size
 ) noexcept {
+    // расписание проверяется до гистограммы: на неизвестном выход - копия входа,
+    // а не неинициализированный буфер
+    if (!ThreadPool::isKnownSchedule(schedule_kind)) {
+        fprintf(stderr, "Unsupported schedule type %s\n", schedule_kind.c_str());
+        copyThrough();
+        return;
+    }
+    if (bytesPerSample != 1) {
+        modifyWide(coeff, threads_count, schedule_kind, chunk_size);
+        return;
+    }
+    TimeMonitor::Phase modifyPhase("modify");
+
     if (data_size == 1) {
+        copyThrough();
         return;
     }
 
     size_t ignoreCount = data_size * coeff;
-    vector<size_t> elements;
+    vector<size_t>& elements = histogram;
     uchar min_v = 255;
     uchar max_v = 0;
 
-    analyzeDataParallelCpp(elements, threads_count, schedule_kind, chunk_size);
-    determineMinMax(ignoreCount, elements, min_v, max_v);
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+        if (!takeParsedHistogram()) {
+            analyzeDataParallelCpp(elements, threads_count, schedule_kind, chunk_size);
+        }
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+    {
+        TimeMonitor::Phase phase("minmax");
+        determineMinMax(ignoreCount, elements, min_v, max_v);
+    }
 
     // если уже растянуто - не делаем ничего
     // или если например 1 цвет - не делаем ничего
-    if ((min_v == 0 && max_v == 255) || min_v >= max_v) {
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
         return;
     }
 
-    float const scale = 255 / float(max_v - min_v);
-    float scaledMinV = scale * float(min_v);
+    TimeMonitor::Phase remapPhase("remap");
 
-    uchar* d = data.data();
+    const uchar* s = sourceData();
+    uchar* d = targetData();
 
-    auto lock = mutex();
-    vector<thread> threads;
-    threads.resize(threads_count);
+    ThreadPool::shared(threads_count).parallelFor(
+        data_size, schedule_kind, chunk_size,
+        [s, d, &table](size_t start, size_t end, int) {
+            remapApply(s + start, d + start, end - start, table);
+        }
+    );
+}
+
+void PNMPicture::modifyLocal(size_t tiles_x, size_t tiles_y, const float clip_limit, const int threads_count) {
+    if (bytesPerSample != 1) {
+        throw runtime_error("16-bit samples are not supported in local contrast mode");
+    }
+    TimeMonitor::Phase modifyPhase("local");
 
-    if (schedule_kind == "static") {
-        if (chunk_size == 0) {
-            for (auto thread_index = 0; thread_index < threads_count; thread_index++) {
-                auto start = data_size * thread_index / threads_count;
-                auto end = data_size * (thread_index + 1) / threads_count;
+    const ImageView source = bodyView(const_cast<uchar*>(sourceData()));
+    contrastLocal(source, bodyView(targetData()), tiles_x, tiles_y, clip_limit, threads_count);
+}
 
-                threads[thread_index] = thread([start, end, scale, scaledMinV, &d]() {
-                    for (size_t i = start; i < end; i++) {
-                        int scaledValue = int(scale * float(d[i]) - scaledMinV);
-                        d[i] = max(0, min(scaledValue, 255));
-                    }
-                });
-            }
-        } else {
-            for (auto thread_index = 0; thread_index < threads_count; thread_index++) {
-                auto start = thread_index  * chunk_size;
-                auto end = data_size;
-                auto increment = (threads_count - 1) * chunk_size + 1;
-
-                threads[thread_index] = thread([chunk_size, start, end, increment, scale, scaledMinV, &d]() {
-                    size_t i = start;
-                    int cur_chunk = chunk_size;
-                    while (i < end) {
-                        int scaledValue = int(scale * float(d[i]) - scaledMinV);
-                        d[i] = max(0, min(scaledValue, 255));
-
-                        cur_chunk -= 1;
-
-                        if (cur_chunk > 0) {
-                            i += 1;
-                        } else if (cur_chunk == 0) {
-                            cur_chunk = chunk_size;
-                            i += increment;
-                        }
-                    }
-                });
+// Поканальное растяжение P6: три гистограммы за один проход по чередующимся
+// RGB-байтам, determineMinMax для каждого канала отдельно и ещё один проход
+// через три таблицы. Для P5 и 16-битных изображений совпадает с modifyParallelCpp
+void PNMPicture::modifyPerChannel(const float coeff, const int threads_count) noexcept {
+    if (channelsCount != 3 || bytesPerSample != 1) {
+        modifyParallelCpp(coeff, threads_count, "static", 0);
+        return;
+    }
+    TimeMonitor::Phase modifyPhase("modify");
+
+    const size_t pixelsCount = data_size / 3;
+    const uchar* s = sourceData();
+    uchar* d = targetData();
+    ThreadTeam pool = ThreadPool::shared(threads_count);
+
+    vector<size_t>& elements = histogram;
+    elements.assign(3 * 256, 0);
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+
+        HistogramReduction<size_t> reduction(pool.size(), 3 * 256);
+        pool.parallelFor(pixelsCount, "static", 0, [s, &reduction](size_t start, size_t end, int thread_index) {
+            histogramAccumulateRgb(s + 3 * start, end - start, reduction.row(thread_index));
+        });
+        reduction.reduce(elements.data(), pool.size());
+
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+
+    uchar tables[3 * 256];
+    bool isIdentity = true;
+    {
+        TimeMonitor::Phase phase("minmax");
+        size_t ignoreCount = pixelsCount * coeff;
+        for (int channel = 0; channel < 3; channel++) {
+            vector<size_t> channelElements(elements.begin() + 256 * channel, elements.begin() + 256 * (channel + 1));
+            uchar min_v = 255;
+            uchar max_v = 0;
+            determineMinMax(ignoreCount, channelElements, min_v, max_v);
+
+            // уже растянутый или одноцветный канал без операторов остаётся как есть
+            if (buildTable(min_v, max_v, tables + 256 * channel)) {
+                isIdentity = false;
             }
         }
-    } else if (schedule_kind == "dynamic") {
-        int cur_chunk_start = 0;
-        auto data_end = data_size;
-        int dynamic_chunk_size;
-        if (chunk_size == 0) {
-            dynamic_chunk_size = 1;
-        } else {
-            dynamic_chunk_size = chunk_size;
-        }
+    }
+
+    if (isIdentity) {
+        copyThrough();
+        return;
+    }
+
+    TimeMonitor::Phase remapPhase("remap");
+    pool.parallelFor(pixelsCount, "static", 0, [s, d, &tables](size_t start, size_t end, int) {
+        remapApplyRgb(s + 3 * start, d + 3 * start, end - start, tables);
+    });
+}
 
-        for (int thread_index = 0; thread_index < threads_count; ++thread_index) {
-            threads[thread_index] = thread([&d, data_end, &lock, &cur_chunk_start, dynamic_chunk_size, scale, scaledMinV]() {
+// выборка читает по кэш-линии на значение - выгодна, только когда страта заметно больше линии
+static constexpr size_t minStratumSize = 256;
+// вероятность, что оценка по выборке выдаст неверную корзину
+static constexpr double quantileFailureProbability = 1e-4;
+
+// Приближённый режим: вместо гистограммы всего изображения - гистограмма
+// стратифицированной выборки, границы по ней проверяются на расстояние до краёв
+// корзин (quantile.h). Если выборка не гарантирует корзину, как и в маленьких
+// изображениях, строится точная гистограмма. Границы симметричные (determineQuantiles)
+void PNMPicture::modifyApproximate(const float coeff, const int threads_count, const size_t sample_size) noexcept {
+    if (bytesPerSample != 1) {
+        modifyParallelCpp(coeff, threads_count, "static", 0);
+        return;
+    }
+    TimeMonitor::Phase modifyPhase("modify");
 
-                lock.lock();
-                int i = cur_chunk_start;
-                cur_chunk_start += dynamic_chunk_size;
-                lock.unlock();
+    if (data_size == 1) {
+        copyThrough();
+        return;
+    }
 
-                int end = i + dynamic_chunk_size;
+    const uchar* s = sourceData();
+    ThreadTeam pool = ThreadPool::shared(threads_count);
 
-                while (i < data_end) {
-                    int scaledValue = int(scale * float(d[i]) - scaledMinV);
-                    d[i] = max(0, min(scaledValue, 255));
-                    i++;
+    size_t ignoreCount = data_size * coeff;
+    vector<size_t>& elements = histogram;
+    size_t min_v = 255;
+    size_t max_v = 0;
+
+    bool isEstimated = false;
+    quantileError = 0;
+    if (sample_size > 0 && data_size / sample_size >= minStratumSize) {
+        TimeMonitor::Phase phase("sample");
+        elements.assign(256, 0);
+
+        HistogramReduction<size_t> reduction(pool.size(), 256);
+        pool.parallelFor(sample_size, "static", 0, [this, s, sample_size, &reduction](size_t start, size_t end, int thread_index) {
+            sampleAccumulate(s, data_size, sample_size, start, end, reduction.row(thread_index));
+        });
+        reduction.reduce(elements.data(), pool.size());
+
+        double errorBound = quantileErrorBound(sample_size, quantileFailureProbability);
+        isEstimated = estimateQuantiles(ignoreCount, data_size, elements.data(), sample_size, 256,
+                                        errorBound, min_v, max_v);
+        if (isEstimated) {
+            quantileError = errorBound;
+        }
+    }
 
-                    if (i == end) {
-                        lock.lock();
-                        i = cur_chunk_start;
-                        cur_chunk_start += dynamic_chunk_size;
-                        lock.unlock();
-                        end = i + dynamic_chunk_size;
-                    }
-                }
-            });
+    if (!isEstimated) {
+        {
+            TimeMonitor::Phase phase("histogram");
+            auto histogramStart = chrono::steady_clock::now();
+            analyzeDataParallelCpp(elements, threads_count, "static", 0);
+            histogramGBps = throughputGBps(data_size, histogramStart);
         }
-    } else {
-        printf("Unsupported schedule type");
-        return;
+        TimeMonitor::Phase phase("minmax");
+        determineQuantiles(ignoreCount, data_size, elements.data(), 256, min_v, max_v);
     }
 
-    for (int thread_index = 0; thread_index < threads_count; ++thread_index) {
-        threads[thread_index].join();
+    // если уже растянуто или 1 цвет - не делаем ничего
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
+        return;
     }
+
+    TimeMonitor::Phase remapPhase("remap");
+
+    uchar* d = targetData();
+    pool.parallelFor(data_size, "static", 0, [s, d, &table](size_t start, size_t end, int) {
+        remapApply(s + start, d + start, end - start, table);
+    });
 }
 
-void PNMPicture::determineMinMax(
-    size_t ignoreCount,
-    const vector<size_t> &elements,
-    uchar &min_v,
-    uchar &max_v
-) const noexcept {
-    int darkCount = 0;
-    bool isDarkComplete = false;
-
-    int brightCount = 0;
-    bool isBrightComplete = false;
-
-    for (size_t i = 0; i < 256; i++) {
-        if (!isDarkComplete) {
-            size_t darkIndex = i;
-            int element = elements[darkIndex];
-            if (darkCount < ignoreCount) {
-                darkCount += element;
-            }
+// 16-битные отсчёты. Гистограмма на 65536 корзин в каждом потоке не помещается
+// в L1/L2, поэтому она двухуровневая (см. histogramAccumulateCoarse16):
+// первый проход по данным - грубая гистограмма по старшему байту и грубые границы,
+// второй - точные гистограммы только двух граничных корзин
+void PNMPicture::modifyWide(
+    const float coeff,
+    const int threads_count,
+    const string schedule_kind,
+    const int chunk_size
+) noexcept {
+    TimeMonitor::Phase modifyPhase("modify");
+
+    if (!ThreadPool::isKnownSchedule(schedule_kind)) {
+        fprintf(stderr, "Unsupported schedule type %s\n", schedule_kind.c_str());
+        copyThrough();
+        return;
+    }
+
+    const size_t samplesCount = data_size / 2;
+    if (samplesCount == 1) {
+        copyThrough();
+        return;
+    }
 
-            if (darkCount >= ignoreCount && element != 0) {
-                isDarkComplete = true;
-                min_v = darkIndex;
+    const uchar* s = sourceData();
+    ThreadTeam pool = ThreadPool::shared(threads_count);
+
+    size_t ignoreCount = samplesCount * coeff;
+    // [0..256) - грубая гистограмма, [256..512) и [512..768) - точные для границ
+    vector<size_t>& elements = histogram;
+    elements.assign(3 * 256, 0);
+    size_t coarseMin = 255;
+    size_t coarseMax = 0;
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+
+        HistogramReduction<size_t> coarse(pool.size(), 256);
+        pool.parallelFor(
+            samplesCount, schedule_kind, chunk_size,
+            [s, &coarse](size_t start, size_t end, int thread_index) {
+                histogramAccumulateCoarse16(s + 2 * start, end - start, coarse.row(thread_index));
             }
+        );
+        coarse.reduce(elements.data(), pool.size());
+        // первая непустая корзина после ignoreCount значений на точном уровне лежит
+        // в первой такой же корзине грубого уровня, последняя непустая - в последней
+        ::determineMinMax(ignoreCount, elements.data(), 256, coarseMin, coarseMax);
+
+        if (coarseMin <= coarseMax) {
+            HistogramReduction<size_t> fine(pool.size(), 2 * 256);
+            pool.parallelFor(
+                samplesCount, schedule_kind, chunk_size,
+                [s, coarseMin, coarseMax, &fine](size_t start, size_t end, int thread_index) {
+                    histogramAccumulateFine16(s + 2 * start, end - start, coarseMin, coarseMax,
+                                              fine.row(thread_index));
+                }
+            );
+            fine.reduce(elements.data() + 256, pool.size());
         }
-        if (!isBrightComplete) {
-            size_t brightIndex = 255 - i;
-            int element = elements[brightIndex];
-            if (brightCount < ignoreCount) {
-                brightCount += element;
-            }
 
-            if (brightCount >= ignoreCount && element != 0) {
-                isBrightComplete = true;
-                max_v = brightIndex;
-            }
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+
+    size_t min_v = 65535;
+    size_t max_v = 0;
+    if (coarseMin <= coarseMax) {
+        TimeMonitor::Phase phase("minmax");
+        // значения из грубых корзин левее coarseMin уже пропущены
+        size_t skippedCount = 0;
+        for (size_t i = 0; i < coarseMin; i++) {
+            skippedCount += elements[i];
         }
+        size_t fineMin = 255;
+        size_t fineMax = 0;
+        size_t unused;
+        ::determineMinMax(ignoreCount > skippedCount ? ignoreCount - skippedCount : 0,
+                          elements.data() + 256, 256, fineMin, unused);
+        ::determineMinMax(0, elements.data() + 512, 256, unused, fineMax);
+        min_v = coarseMin * 256 + fineMin;
+        max_v = coarseMax * 256 + fineMax;
+    }
+
+    // если уже растянуто или 1 цвет - не делаем ничего
+    vector<uint16_t> table(65536);
+    if (!buildTable16(min_v, max_v, table.data())) {
+        copyThrough();
+        return;
+    }
 
-        if (isDarkComplete && isBrightComplete) {
-            break;
+    TimeMonitor::Phase remapPhase("remap");
+
+    uchar* d = targetData();
+    pool.parallelFor(
+        samplesCount, schedule_kind, chunk_size,
+        [s, d, &table](size_t start, size_t end, int) {
+            remapApply16(s + 2 * start, d + 2 * start, end - start, table.data());
         }
+    );
+}
+
+// Двухпроходная потоковая обработка: изображение целиком в памяти не держится.
+// 1 проход - читаем тело полосами и копим только гистограмму
+// 2 проход - перечитываем полосы, растягиваем и сразу пишем в выходной файл
+// Пиковая память ограничена stripSize
+void PNMPicture::modifyStreaming(
+    const string& inputFileName,
+    const string& outputFileName,
+    const float coeff,
+    const size_t stripSize
+) {
+    if (stripSize == 0) {
+        throw runtime_error("Strip size must be positive");
+    }
+    TimeMonitor::Phase streamPhase("stream");
+
+    fin = fopen(inputFileName.c_str(), "rb");
+    if (fin == nullptr) {
+        throw runtime_error("Error while trying to open input file");
+    }
+
+    readHeader();
+    determineChannels();
+    if (bytesPerSample != 1) {
+        throw runtime_error("16-bit samples are not supported in streaming mode");
+    }
+    if (isAscii()) {
+        throw runtime_error("ASCII PNM is not supported in streaming mode");
     }
+    const off_t bodyOffset = ftello(fin);
 
-    for (size_t i = 0; i < 256; i++) {
-        size_t brightIndex = 255 - i;
-        int element = elements[brightIndex];
-        if (brightCount < ignoreCount) {
-            brightCount += element;
+    vector<uchar> strip(min(stripSize, data_size));
+    vector<size_t> elements(256, 0);
+
+    size_t bytesLeft = data_size;
+    while (bytesLeft > 0) {
+        size_t toRead = min(strip.size(), bytesLeft);
+        {
+            TimeMonitor::Phase phase("read");
+            if (fread(strip.data(), 1, toRead, fin) != toRead) {
+                throw runtime_error("Error while trying to read file");
+            }
         }
+        {
+            TimeMonitor::Phase phase("histogram");
+            histogramAccumulate(strip.data(), toRead, elements.data());
+        }
+        bytesLeft -= toRead;
+    }
+
+    size_t ignoreCount = data_size * coeff;
+    uchar min_v = 255;
+    uchar max_v = 0;
+    {
+        TimeMonitor::Phase phase("minmax");
+        determineMinMax(ignoreCount, elements, min_v, max_v);
+    }
+
+    // если уже растянуто или 1 цвет - тело копируется без изменений
+    uchar table[256];
+    bool isCopyOnly = !buildTable(min_v, max_v, table);
+
+    if (fseeko(fin, bodyOffset, SEEK_SET) != 0) {
+        throw runtime_error("Error while trying to read file");
+    }
 
-        if (brightCount >= ignoreCount && element != 0) {
-            max_v = brightIndex;
-            break;
+    fout = fopen(outputFileName.c_str(), "wb");
+    if (fout == nullptr) {
+        throw runtime_error("Error while trying to open output file");
+    }
+    fprintf(fout, "P%d\n%d %d\n%d\n", format, width, height, colors);
+
+    bytesLeft = data_size;
+    while (bytesLeft > 0) {
+        size_t toRead = min(strip.size(), bytesLeft);
+        {
+            TimeMonitor::Phase phase("read");
+            if (fread(strip.data(), 1, toRead, fin) != toRead) {
+                throw runtime_error("Error while trying to read file");
+            }
+        }
+        if (!isCopyOnly) {
+            TimeMonitor::Phase phase("remap");
+            remapApply(strip.data(), strip.data(), toRead, table);
+        }
+        {
+            TimeMonitor::Phase phase("write");
+            if (fwrite(strip.data(), 1, toRead, fout) != toRead) {
+                throw runtime_error("Error while trying to write to file");
+            }
         }
+        bytesLeft -= toRead;
     }
+
+    fclose(fin);
+    fin = nullptr;
+    fclose(fout);
+    fout = nullptr;
 }
 
-void PNMPicture::analyzeData(vector<size_t> & elements) const noexcept {
-    elements.resize(256, 0);
+// Конвейер чтение -> гистограмма -> remap -> запись в два прохода, как modifyStreaming,
+// но с перекрытием стадий. В памяти только кольцо из queueDepth кусков по chunkSize:
+// 1 проход - поток чтения заполняет свободные куски, текущий поток копит по ним
+//   гистограмму и сразу возвращает кусок в кольцо;
+// 2 проход - тело перечитывается, потоки общего пула растягивают куски, а поток
+//   записи сбрасывает их по порядку и возвращает в кольцо.
+// Потоки чтения и записи пул не трогают - им нельзя ждать задачу, которая ждёт их.
+void PNMPicture::modifyPipelined(
+    const string& inputFileName,
+    const string& outputFileName,
+    const float coeff,
+    const int threads_count,
+    const size_t chunkSize,
+    const size_t queueDepth
+) {
+    if (chunkSize == 0 || threads_count <= 0) {
+        throw runtime_error("Chunk size and threads count must be positive");
+    }
+    TimeMonitor::Phase pipelinePhase("pipeline");
+    // у потоков чтения и записи своего стека фаз нет - их время пишется по явному пути
+    const string readPath = TimeMonitor::currentPhasePath() + "/read";
+    const string writePath = TimeMonitor::currentPhasePath() + "/write";
 
-    const uchar* d = data.data();
-    for (size_t i = 0; i < data_size; i++) {
-        elements[d[i]] += 1;
+    fin = fopen(inputFileName.c_str(), "rb");
+    if (fin == nullptr) {
+        throw runtime_error("Error while trying to open input file");
     }
-}
+    readHeader();
+    determineChannels();
+    if (bytesPerSample != 1) {
+        throw runtime_error("16-bit samples are not supported in pipelined mode");
+    }
+    if (isAscii()) {
+        throw runtime_error("ASCII PNM is not supported in pipelined mode");
+    }
+    const off_t bodyOffset = ftello(fin);
 
-void PNMPicture::analyzeDataParallelCUDA(
-    vector<size_t> &elements,
-    const int threads_count
-) const noexcept {
-    elements.resize(256, 0);
-    size_t* result = elements.data();
+    fout = fopen(outputFileName.c_str(), "wb");
+    if (fout == nullptr) {
+        throw runtime_error("Error while trying to open output file");
+    }
 
-    const uchar* d = data.data();
+    const size_t chunksCount = (data_size + chunkSize - 1) / chunkSize;
+    const size_t slotsCount = max<size_t>(min(queueDepth, chunksCount), 1);
+    // кусок не длиннее тела - маленькому изображению не нужен полный chunkSize
+    const size_t slotSize = min(chunkSize, data_size);
+    vector<uchar> slots(slotsCount * slotSize);
+    uchar* ring = slots.data();
+    auto chunkLength = [this, chunkSize](size_t chunk) {
+        return min(chunkSize, data_size - chunk * chunkSize);
+    };
+
+    atomic<bool> isReadFailed = false;
+    atomic<bool> isFailed = false;
+    // номера свободных кусков кольца; ёмкость - всё кольцо, возврат никогда не ждёт
+    BoundedQueue<size_t> freeSlots(slotsCount);
+    // прочитанный кусок изображения и кусок кольца, где он лежит
+    typedef pair<size_t, size_t> ChunkSlot;
+
+    auto readPass = [this, ring, slotSize, chunksCount, &chunkLength, &freeSlots, &isReadFailed, &isFailed, &readPath](
+        BoundedQueue<ChunkSlot>& readChunks
+    ) {
+        TimeMonitor::ThreadPhase threadPhase(readPath, 0);
+        size_t slot;
+        for (size_t chunk = 0; chunk < chunksCount && !isFailed && freeSlots.pop(slot); chunk++) {
+            size_t length = chunkLength(chunk);
+            if (fread(ring + slot * slotSize, 1, length, fin) != length) {
+                isReadFailed = true;
+                break;
+            }
+            readChunks.push({chunk, slot});
+        }
+        readChunks.close();
+    };
 
-#pragma omp parallel num_threads(threads_count)
-    {
-        size_t els[256] = {0};
+    for (size_t slot = 0; slot < slotsCount; slot++) {
+        freeSlots.push(slot);
+    }
 
-#pragma omp for schedule(runtime)
-        for (size_t i = 0; i < data_size; i++) {
-            els[d[i]] += 1;
+    vector<size_t> elements(256, 0);
+    {
+        TimeMonitor::Phase phase("histogram");
+        BoundedQueue<ChunkSlot> readChunks(slotsCount);
+        thread reader(readPass, ref(readChunks));
+        ChunkSlot item;
+        while (readChunks.pop(item)) {
+            histogramAccumulate(ring + item.second * slotSize, chunkLength(item.first), elements.data());
+            freeSlots.push(item.second);
         }
+        reader.join();
+    }
+    if (isReadFailed || fseeko(fin, bodyOffset, SEEK_SET) != 0) {
+        throw runtime_error("Error while trying to read file");
+    }
 
-#pragma omp critical
-        {
-            for (auto i = 0; i < 256; i++) {
-                result[i] += els[i];
+    size_t ignoreCount = data_size * coeff;
+    uchar min_v = 255;
+    uchar max_v = 0;
+    {
+        TimeMonitor::Phase phase("minmax");
+        determineMinMax(ignoreCount, elements, min_v, max_v);
+    }
+
+    // если уже растянуто или 1 цвет - куски уходят на запись без изменений
+    uchar table[256];
+    bool isCopyOnly = !buildTable(min_v, max_v, table);
+
+    fprintf(fout, "P%d\n%d %d\n%d\n", format, width, height, colors);
+
+    BoundedQueue<ChunkSlot> readChunks(slotsCount);
+    BoundedQueue<ChunkSlot> doneChunks(slotsCount);
+    thread reader(readPass, ref(readChunks));
+    thread writer([this, ring, chunksCount, slotSize, &chunkLength, &doneChunks, &freeSlots, &isFailed, &writePath]() {
+        TimeMonitor::ThreadPhase threadPhase(writePath, 0);
+        // куски приходят не по порядку - придерживаем их, пока не готов следующий по счёту;
+        // следующий прочитан раньше всех придержанных, так что кольцо не заклинивает
+        vector<size_t> doneSlots(chunksCount, SIZE_MAX);
+        size_t nextChunk = 0;
+        ChunkSlot item;
+        while (doneChunks.pop(item)) {
+            doneSlots[item.first] = item.second;
+            while (nextChunk < chunksCount && doneSlots[nextChunk] != SIZE_MAX) {
+                size_t slot = doneSlots[nextChunk];
+                size_t length = chunkLength(nextChunk);
+                if (!isFailed && fwrite(ring + slot * slotSize, 1, length, fout) != length) {
+                    isFailed = true;
+                }
+                freeSlots.push(slot);
+                nextChunk++;
             }
         }
+    });
+
+    {
+        TimeMonitor::Phase phase("remap");
+        // каждая итерация забирает очередной прочитанный кусок - номер итерации не важен
+        ThreadPool::shared(threads_count).parallelFor(
+            chunksCount, "dynamic", 1,
+            [ring, slotSize, isCopyOnly, &table, &chunkLength, &readChunks, &doneChunks](size_t, size_t, int) {
+                ChunkSlot item;
+                if (!readChunks.pop(item)) {
+                    return;
+                }
+                if (!isCopyOnly) {
+                    uchar* c = ring + item.second * slotSize;
+                    remapApply(c, c, chunkLength(item.first), table);
+                }
+                doneChunks.push(item);
+            }
+        );
+        reader.join();
+        doneChunks.close();
+        writer.join();
+    }
+
+    fclose(fin);
+    fin = nullptr;
+    fclose(fout);
+    fout = nullptr;
+    if (isReadFailed) {
+        throw runtime_error("Error while trying to read file");
+    }
+    if (isFailed) {
+        throw runtime_error("Error while trying to write to file");
+    }
+}
+
+bool PNMPicture::buildTable(uchar min_v, uchar max_v, uchar* table) const noexcept {
+    bool isStretched = (min_v == 0 && max_v == 255) || min_v >= max_v;
+    if (isStretched && pointOps.empty()) {
+        return false;
+    }
+    // уже растянутое изображение - тождественная таблица, дальше только операторы
+    if (isStretched) {
+        buildRemapTable(0, 255, table);
+    } else {
+        buildRemapTable(min_v, max_v, table);
     }
+    composePointOps(pointOps, table);
+    return true;
+}
+
+bool PNMPicture::buildTable16(size_t min_v, size_t max_v, uint16_t* table) const noexcept {
+    bool isStretched = (min_v == 0 && max_v == size_t(colors)) || min_v >= max_v;
+    if (isStretched && pointOps.empty()) {
+        return false;
+    }
+    if (isStretched) {
+        buildRemapTable16(0, colors, colors, table);
+    } else {
+        buildRemapTable16(min_v, max_v, colors, table);
+    }
+    composePointOps16(pointOps, colors, table);
+    return true;
+}
+
+void PNMPicture::determineMinMax(
+    size_t ignoreCount,
+    const vector<size_t> &elements,
+    uchar &min_v,
+    uchar &max_v
+) const noexcept {
+    size_t min_index = min_v;
+    size_t max_index = max_v;
+    ::determineMinMax(ignoreCount, elements.data(), 256, min_index, max_index);
+    min_v = min_index;
+    max_v = max_index;
+}
+
+void PNMPicture::analyzeData(vector<size_t> & elements) const noexcept {
+    elements.assign(256, 0);
+
+    histogramAccumulate(sourceData(), data_size, elements.data());
 }
 
 void PNMPicture::analyzeDataParallelOmp(
     vector<size_t> &elements,
     const int threads_count
 ) const noexcept {
-    elements.resize(256, 0);
+    elements.assign(256, 0);
     size_t* result = elements.data();
 
-    const uchar* d = data.data();
+    const uchar* d = sourceData();
+    const size_t blocksCount = (data_size + parallelBlockSize - 1) / parallelBlockSize;
+    const string phasePath = TimeMonitor::currentPhasePath();
+    // строки потоков на своих линиях кэша; вместо critical - свёртка по столбцам,
+    // её omp for начинается после неявного барьера цикла накопления
+    HistogramReduction<size_t> reduction(max(threads_count, 1), 256);
+    const size_t columnsCount = reduction.columnsCount();
 
 #pragma omp parallel num_threads(threads_count)
     {
-        size_t els[256] = {0};
+        TimeMonitor::ThreadPhase threadPhase(phasePath, omp_get_thread_num());
+        size_t* els = reduction.row(omp_get_thread_num());
 
 #pragma omp for schedule(runtime)
-        for (size_t i = 0; i < data_size; i++) {
-            els[d[i]] += 1;
+        for (size_t block = 0; block < blocksCount; block++) {
+            size_t start = block * parallelBlockSize;
+            size_t end = min(start + parallelBlockSize, data_size);
+            histogramAccumulate(d + start, end - start, els);
         }
 
-#pragma omp critical
-        {
-            for (auto i = 0; i < 256; i++) {
-                result[i] += els[i];
-            }
+#pragma omp for schedule(static)
+        for (size_t column = 0; column < columnsCount; column++) {
+            reduction.reduceColumns(column, column + 1, result);
         }
     }
 }
@@ -423,112 +1231,24 @@ void PNMPicture::analyzeDataParallelCpp(
         const string schedule_kind,
         const int chunk_size
 ) const noexcept {
-    elements.resize(256, 0);
-    size_t* result = elements.data();
+    elements.assign(256, 0);
+    if (!ThreadPool::isKnownSchedule(schedule_kind)) {
+        fprintf(stderr, "Unsupported schedule type %s\n", schedule_kind.c_str());
+        return;
+    }
 
-    const uchar* d = data.data();
-
-    auto critical_section_lock = mutex();
-    auto dynamic_schedule_lock = mutex();
-    vector<thread> threads;
-    threads.resize(threads_count);
-
-    if (schedule_kind == "static") {
-        if (chunk_size == 0) {
-            for (auto thread_index = 0; thread_index < threads_count; thread_index++) {
-                auto start = data_size * thread_index / threads_count;
-                auto end = data_size * (thread_index + 1) / threads_count;
-
-                threads[thread_index] = thread([start, end, &d, &critical_section_lock, &result]() {
-                    size_t els[256] = {0};
-                    for (size_t i = start; i < end; i++) {
-                        els[d[i]] += 1;
-                    }
-
-                    critical_section_lock.lock();
-                    for (auto i = 0; i < 256; i++) {
-                        result[i] += els[i];
-                    }
-                    critical_section_lock.unlock();
-                });
-            }
-        } else {
-            for (auto thread_index = 0; thread_index < threads_count; thread_index++) {
-                auto start = thread_index  * chunk_size;
-                auto end = data_size;
-                auto increment = (threads_count - 1) * chunk_size + 1;
-
-                threads[thread_index] = thread([chunk_size, start, end, increment, &d, &critical_section_lock, &result]() {
-                    size_t els[256] = {0};
-                    size_t i = start;
-                    int cur_chunk = chunk_size;
-                    while (i < end) {
-                        els[d[i]] += 1;
-
-                        cur_chunk -= 1;
-
-                        if (cur_chunk > 0) {
-                            i += 1;
-                        } else if (cur_chunk == 0) {
-                            cur_chunk = chunk_size;
-                            i += increment;
-                        }
-                    }
-
-                    critical_section_lock.lock();
-                    for (auto j = 0; j < 256; j++) {
-                        result[j] += els[j];
-                    }
-                    critical_section_lock.unlock();
-                });
-            }
-        }
-    } else if (schedule_kind == "dynamic") {
-        int cur_chunk_start = 0;
-        auto data_end = data_size;
-        int dynamic_chunk_size;
-        if (chunk_size == 0) {
-            dynamic_chunk_size = 1;
-        } else {
-            dynamic_chunk_size = chunk_size;
-        }
+    const uchar* d = sourceData();
 
-        for (int thread_index = 0; thread_index < threads_count; ++thread_index) {
-            threads[thread_index] = thread([&d, data_end, &critical_section_lock, &cur_chunk_start, dynamic_chunk_size, &dynamic_schedule_lock, &result]() {
-                size_t els[256] = {0};
-                dynamic_schedule_lock.lock();
-                int i = cur_chunk_start;
-                cur_chunk_start += dynamic_chunk_size;
-                dynamic_schedule_lock.unlock();
-
-                int end = i + dynamic_chunk_size;
-
-                while (i < data_end) {
-                    els[d[i]] += 1;
-                    i++;
-
-                    if (i == end) {
-                        dynamic_schedule_lock.lock();
-                        i = cur_chunk_start;
-                        cur_chunk_start += dynamic_chunk_size;
-                        dynamic_schedule_lock.unlock();
-                        end = i + dynamic_chunk_size;
-                    }
-                }
+    ThreadTeam pool = ThreadPool::shared(threads_count);
+    // у каждого потока своя гистограмма, складываем их после завершения цикла
+    HistogramReduction<size_t> reduction(pool.size(), 256);
 
-                critical_section_lock.lock();
-                for (auto j = 0; j < 256; j++) {
-                    result[j] += els[j];
-                }
-                critical_section_lock.unlock();
-            });
+    pool.parallelFor(
+        data_size, schedule_kind, chunk_size,
+        [d, &reduction](size_t start, size_t end, int thread_index) {
+            histogramAccumulate(d + start, end - start, reduction.row(thread_index));
         }
-    } else {
-        printf("Unsupported schedule type");
-        return;
-    }
+    );
 
-    for (int thread_index = 0; thread_index < threads_count; ++thread_index) {
-        threads[thread_index].join();
-    }
-}
\ No newline at end of file
+    reduction.reduce(elements.data(), pool.size());
+}
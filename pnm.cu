@@ -2,188 +2,151 @@
 // Created by Igor Kluzhev on 25.09.2024.
 //
 
+// CUDA-бэкенд: собирается вместе с pnm.cpp только при найденном CUDA toolkit
+// (CONTRAST_WITH_CUDA) и определяет лишь то, что считается на GPU.
+// Чтение, запись и все CPU-варианты остаются в pnm.cpp
+
 #include "pnm.h"
-#include <cmath>
-#include <stdio.h>
-#include <stdexcept>
+#include "backend.h"
+#include "histogram.h"
+#include "remap.h"
+#include "time_monitor.h"
 #include <cuda_runtime.h>
-#include <cuda.h>
 
 using namespace std;
 
-PNMPicture::PNMPicture() = default;
-PNMPicture::PNMPicture(const string& filename) {
-    read(filename);
-}
+static constexpr int blockThreads = 256;
+static constexpr int maxBlocks = 1024;
 
-PNMPicture::~PNMPicture() {
-    if (fin != nullptr) {
-        fclose(fin);
-    }
-    if (fout != nullptr) {
-        fclose(fout);
+// у каждого блока своя гистограмма в shared memory, в глобальную - по atomicAdd на корзину
+__global__ void histogramKernel(const uchar* d, size_t size, unsigned long long* elements) {
+    __shared__ unsigned int local[256];
+    for (int i = threadIdx.x; i < 256; i += blockDim.x) {
+        local[i] = 0;
     }
-}
+    __syncthreads();
 
-void PNMPicture::read(const string& fileName) {
-    fin = fopen(fileName.c_str(), "rb");
-    if (fin == nullptr) {
-        throw runtime_error("Error while trying to open input file");
+    const size_t stride = size_t(blockDim.x) * gridDim.x;
+    for (size_t i = size_t(blockIdx.x) * blockDim.x + threadIdx.x; i < size; i += stride) {
+        atomicAdd(&local[d[i]], 1u);
     }
+    __syncthreads();
 
-    char p;
-    char binChar;
-    fscanf(fin, "%c%i%c%d %d%c%d%c", &p, &format, &binChar, &width, &height, &binChar, &colors, &binChar);
-
-    if (p != 'P')
-        throw runtime_error("Unsupported format input file");
-
-    read();
-    fclose(fin);
-    fin = nullptr;
+    for (int i = threadIdx.x; i < 256; i += blockDim.x) {
+        if (local[i] != 0) {
+            atomicAdd(&elements[i], (unsigned long long)local[i]);
+        }
+    }
 }
 
-void PNMPicture::read() {
-    if (format == 5) {
-        channelsCount = 1;
-    } else if (format == 6) {
-        channelsCount = 3;
-    } else {
-        throw runtime_error("Unsupported format of PNM file");
+// таблица та же, что у CPU-бэкендов (buildTable), - результат побитово совпадает
+__global__ void remapKernel(uchar* d, size_t size, const uchar* table) {
+    __shared__ uchar localTable[256];
+    for (int i = threadIdx.x; i < 256; i += blockDim.x) {
+        localTable[i] = table[i];
     }
-    data_size = width * height * channelsCount;
-    data.resize(data_size);
+    __syncthreads();
 
-    const size_t bytesRead = fread(data.data(), 1, data_size, fin);
-
-    if (bytesRead != data_size) {
-        throw runtime_error("Error while trying to read file");
+    const size_t stride = size_t(blockDim.x) * gridDim.x;
+    for (size_t i = size_t(blockIdx.x) * blockDim.x + threadIdx.x; i < size; i += stride) {
+        d[i] = localTable[d[i]];
     }
 }
 
-void PNMPicture::write(const string& fileName) {
-    fout = fopen(fileName.c_str(), "wb");
-    if (fout == nullptr) {
-        throw runtime_error("Error while trying to open output file");
-    }
-
-    write();
-    fclose(fout);
-    fout = nullptr;
+bool cudaBackendAvailable() {
+    int devicesCount = 0;
+    return cudaGetDeviceCount(&devicesCount) == cudaSuccess && devicesCount > 0;
 }
 
-void PNMPicture::write() {
-    fprintf(fout, "P%d\n%d %d\n%d\n", format, width, height, colors);
+// буферы на устройстве, освобождаются при выходе из modifyParallelCUDA
+struct DeviceBuffers {
+    uchar* body = nullptr;
+    unsigned long long* elements = nullptr;
+    uchar* table = nullptr;
 
-    size_t dataSize = width * height * channelsCount;
-    const size_t writtenBytes = fwrite(data.data(), 1, dataSize, fout);
+    ~DeviceBuffers() {
+        cudaFree(body);
+        cudaFree(elements);
+        cudaFree(table);
+    }
+};
 
-    if (writtenBytes != dataSize) {
-        throw runtime_error("Error while trying to write to file");
+// 16-битные изображения и любые ошибки CUDA (нет устройства, не хватило памяти) -
+// тот же результат на CPU
+void PNMPicture::modifyParallelCUDA(const float coeff, const int device_index) noexcept {
+    if (bytesPerSample != 1) {
+        modifyWide(coeff, 1, "static", 0);
+        return;
     }
-}
+    TimeMonitor::Phase modifyPhase("modify");
 
-// 1) изначально при итерировании собираем кол-ва по каждому цвету
-// 2) при итерировании по цветам суммируем кол-во для тёмных и светлых
-// 3) при достижении нужного кол-ва - идём дальше
-// и сохраняем первый попавшийся индекс с ненулевым значением как минимальный/максимальный цвет
-// 4) вычисляем min/max
-// 5) пробегаемся ещё раз и меняем значения
-// доступные методы: omp + simd + ilp
+    if (data_size <= 1) {
+        copyThrough();
+        return;
+    }
 
-void PNMPicture::modifyParallelCUDA(const float coeff, const int device_index) noexcept {
-    if (data_size == 1) {
+    DeviceBuffers buffers;
+    bool isOk = cudaSetDevice(device_index) == cudaSuccess
+                && cudaMalloc(&buffers.body, data_size) == cudaSuccess
+                && cudaMalloc(&buffers.elements, 256 * sizeof(unsigned long long)) == cudaSuccess
+                && cudaMalloc(&buffers.table, 256) == cudaSuccess;
+    if (!isOk) {
+        modify(coeff);
         return;
     }
 
+    const int blocksCount = int(min<size_t>(maxBlocks, (data_size + blockThreads - 1) / blockThreads));
+
     size_t ignoreCount = data_size * coeff;
-    vector<size_t> elements;
+    vector<size_t>& elements = histogram;
     uchar min_v = 255;
     uchar max_v = 0;
 
-    analyzeDataParallelCUDA(elements);
-    determineMinMax(ignoreCount, elements, min_v, max_v);
+    {
+        TimeMonitor::Phase phase("transfer");
+        isOk = cudaMemcpy(buffers.body, sourceData(), data_size, cudaMemcpyHostToDevice) == cudaSuccess;
+    }
+    {
+        TimeMonitor::Phase phase("histogram");
+        auto histogramStart = chrono::steady_clock::now();
+        unsigned long long deviceElements[256];
+        isOk = isOk
+               && cudaMemset(buffers.elements, 0, sizeof(deviceElements)) == cudaSuccess
+               && (histogramKernel<<<blocksCount, blockThreads>>>(buffers.body, data_size, buffers.elements),
+                   cudaGetLastError() == cudaSuccess)
+               && cudaMemcpy(deviceElements, buffers.elements, sizeof(deviceElements), cudaMemcpyDeviceToHost) == cudaSuccess;
+        if (!isOk) {
+            modify(coeff);
+            return;
+        }
+        elements.assign(deviceElements, deviceElements + 256);
+        histogramGBps = throughputGBps(data_size, histogramStart);
+    }
+    {
+        TimeMonitor::Phase phase("minmax");
+        determineMinMax(ignoreCount, elements, min_v, max_v);
+    }
 
     // если уже растянуто - не делаем ничего
     // или если например 1 цвет - не делаем ничего
-    if ((min_v == 0 && max_v == 255) || min_v >= max_v) {
+    uchar table[256];
+    if (!buildTable(min_v, max_v, table)) {
+        copyThrough();
         return;
     }
 
-    float const scale = 255 / float(max_v - min_v);
-    float scaledMinV = scale * float(min_v);
-
-    uchar* d = data.data();
-    for (size_t i = 0; i < data_size; i++) {
-        int scaledValue1 = scale * d[i] - scaledMinV;
-        d[i] = max(0, min(scaledValue1, 255));
-    }
-}
-
-void PNMPicture::determineMinMax(
-    size_t ignoreCount,
-    const vector<size_t> &elements,
-    uchar &min_v,
-    uchar &max_v
-) const noexcept {
-    int darkCount = 0;
-    bool isDarkComplete = false;
-
-    int brightCount = 0;
-    bool isBrightComplete = false;
-
-    for (size_t i = 0; i < 256; i++) {
-        if (!isDarkComplete) {
-            size_t darkIndex = i;
-            int element = elements[darkIndex];
-            if (darkCount < ignoreCount) {
-                darkCount += element;
-            }
-
-            if (darkCount >= ignoreCount && element != 0) {
-                isDarkComplete = true;
-                min_v = darkIndex;
-            }
-        }
-        if (!isBrightComplete) {
-            size_t brightIndex = 255 - i;
-            int element = elements[brightIndex];
-            if (brightCount < ignoreCount) {
-                brightCount += element;
-            }
-
-            if (brightCount >= ignoreCount && element != 0) {
-                isBrightComplete = true;
-                max_v = brightIndex;
-            }
-        }
+    TimeMonitor::Phase remapPhase("remap");
 
-        if (isDarkComplete && isBrightComplete) {
-            break;
-        }
+    isOk = cudaMemcpy(buffers.table, table, sizeof(table), cudaMemcpyHostToDevice) == cudaSuccess
+           && (remapKernel<<<blocksCount, blockThreads>>>(buffers.body, data_size, buffers.table),
+               cudaGetLastError() == cudaSuccess)
+           && cudaDeviceSynchronize() == cudaSuccess;
+    if (!isOk) {
+        // тело на хосте ещё не тронуто - растягиваем на CPU по той же таблице
+        remapApply(sourceData(), targetData(), data_size, table);
+        return;
     }
 
-    for (size_t i = 0; i < 256; i++) {
-        size_t brightIndex = 255 - i;
-        int element = elements[brightIndex];
-        if (brightCount < ignoreCount) {
-            brightCount += element;
-        }
-
-        if (brightCount >= ignoreCount && element != 0) {
-            max_v = brightIndex;
-            break;
-        }
-    }
+    TimeMonitor::Phase phase("transfer");
+    cudaMemcpy(targetData(), buffers.body, data_size, cudaMemcpyDeviceToHost);
 }
-
-void PNMPicture::analyzeDataParallelCUDA(
-    vector<size_t> &elements
-) const noexcept {
-    elements.resize(256, 0);
-
-    const uchar* d = data.data();
-    for (size_t i = 0; i < data_size; i++) {
-        elements[d[i]] += 1;
-    }
-}
\ No newline at end of file
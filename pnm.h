@@ -9,6 +9,10 @@
 
 #include <string>
 #include <vector>
+#include "mapped_file.h"
+#include "image_buffer.h"
+#include "contrast.h"
+#include "point_ops.h"
 
 using namespace std;
 
@@ -25,23 +29,153 @@ public:
 
     void write(const string& fileName) ;
     void write();
+    // только заголовок: формат, размеры и data_size без чтения тела;
+    // возвращает длину заголовка - с неё во входном файле начинается тело
+    size_t probe(const string& fileName);
 
+    // mmap-режим: тело входного файла отображается только на чтение,
+    // inPlace = true - отображается на запись и модифицируется прямо в файле
+    void readMapped(const string& fileName, bool inPlace = false);
+    // PNM-файл целиком в дескрипторе fd (memfd) - изменяется на месте, fd переходит во владение
+    void readMapped(int fd);
+    // заранее создаёт выходной файл нужного размера - modify* пишут прямо в него
+    void mapOutput(const string& fileName);
+    void closeMapped() noexcept;
+
+    // потоковый режим для изображений больше RAM: гистограмма и remap
+    // идут полосами по stripSize байт, data не используется
+    void modifyStreaming(
+        const string& inputFileName,
+        const string& outputFileName,
+        const float coeff,
+        const size_t stripSize
+    );
+    // конвейерный режим: чтение с диска перекрывается с гистограммой,
+    // а remap - с записью; в памяти не больше queueDepth кусков по chunkSize байт,
+    // тело читается дважды, data не используется
+    void modifyPipelined(
+        const string& inputFileName,
+        const string& outputFileName,
+        const float coeff,
+        const int threads_count,
+        const size_t chunkSize,
+        const size_t queueDepth
+    );
+
+    // покадровый режим (frame_stream.h): кадры идут подряд в одном открытом потоке
+    void readFrame(FILE* in);
+    void writeFrame(FILE* out);
+    // гистограмма и границы без remap - кадр анализируется, пока предыдущий растягивается
+    void analyzeFrame(const float coeff, uchar& min_v, uchar& max_v) noexcept;
+    // remap по готовым (например, сглаженным) границам
+    void remapFrame(uchar min_v, uchar max_v, const int threads_count) noexcept;
+
+    // P2/P3: тело разбирается в тот же двоичный вид, что у P5/P6, и форматируется
+    // обратно при записи; true, если формат ASCII
+    bool isAscii() const noexcept;
+
+    void modify(const float coeff) noexcept;
+    // эталон: один поток и скалярные ядра гистограммы и remap
+    void modifyScalar(const float coeff) noexcept;
+    void modifyParallelOmp(const float coeff, const int threads_count) noexcept;
+    void modifyParallelCpp(
+        const float coeff,
+        const int threads_count,
+        const string schedule_kind,
+        const int chunk_size
+    ) noexcept;
+    // в сборке с CUDA (CONTRAST_WITH_CUDA, pnm.cu) - на GPU device_index,
+    // без неё и при ошибках CUDA - однопоточный modify
     void modifyParallelCUDA(const float coeff, const int device_index) noexcept;
+    // P6: отдельное растяжение для R, G и B
+    void modifyPerChannel(const float coeff, const int threads_count) noexcept;
+    // границы по случайной выборке из sample_size байт, полная гистограмма - только
+    // если выборка не определяет их точно. Границы симметричные (quantile.h): в отличие
+    // от modify и остальных режимов, светлая граница тоже отступает на coeff, так что
+    // результат не совпадает с точным даже без ошибки выборки. 16 бит - точный modifyParallelCpp
+    void modifyApproximate(const float coeff, const int threads_count, const size_t sample_size) noexcept;
+    // локальное растяжение по тайлам (local_contrast.h) вместо одной пары границ;
+    // только 8-битные отсчёты, на 16-битных бросает runtime_error
+    void modifyLocal(size_t tiles_x, size_t tiles_y, const float clip_limit, const int threads_count);
 
     int format;
     int width, height;
     int colors;
     size_t data_size;
     short channelsCount;
-    FILE *fin;
-    FILE *fout;
-    vector<uchar> data;
+    // 1 - 8-битные отсчёты, 2 - 16-битные big-endian (maxval > 255)
+    short bytesPerSample = 1;
+    FILE *fin = nullptr;
+    FILE *fout = nullptr;
+    ImageBuffer data;
+    // скорость последнего построения гистограммы, ГБ/с
+    double histogramGBps = 0;
+    // граница ошибки F_n последней оценки по выборке, 0 - границы по точной гистограмме
+    double quantileError = 0;
+    // сколько потоков разбирают и форматируют тело P2/P3
+    int asciiThreadsCount = 1;
+    // поточечные операторы (point_ops.h) после растяжения во всех modify* этого изображения,
+    // кроме modifyLocal: они сворачиваются в таблицу remap, лишних проходов нет.
+    // По умолчанию цепочка пустая - только растяжение
+    vector<PointOp> pointOps;
 
 private:
-    void analyzeDataParallelCUDA(vector<size_t> &elements) const noexcept;
+    void readHeader();
+    size_t parseHeader(const uchar* buffer, size_t length);
+    void determineChannels();
+    void attachInputMapping(bool inPlace);
+    // read через BlockFile (block_io.h) - io_uring или pread вместо FILE*
+    void readBlocks(const string& fileName);
+    // разбор тела P2/P3 из text в data
+    void parseAsciiBody(const char* text, size_t length);
+    // true - histogram уже собрана при разборе ASCII, отдельный проход не нужен;
+    // сбрасывается при первом использовании
+    bool takeParsedHistogram() noexcept;
+
+    const uchar* sourceData() const noexcept;
+    // тело как вид для ядра libcontrast
+    ImageView bodyView(uchar* d) const noexcept;
+    uchar* targetData() noexcept;
+    void copyThrough() noexcept;
+
+    void analyzeData(vector<size_t> &elements) const noexcept;
+    void analyzeDataParallelOmp(vector<size_t> &elements, const int threads_count) const noexcept;
+    void analyzeDataParallelCpp(
+        vector<size_t> &elements,
+        const int threads_count,
+        const string schedule_kind,
+        const int chunk_size
+    ) const noexcept;
 
     void determineMinMax(size_t ignoreCount, const vector<size_t> &elements, uchar &min_v,
                          uchar &max_v) const noexcept;
+
+    // таблица растяжения [min_v, max_v] вместе с операторами pointOps;
+    // false - уже растянуто или 1 цвет и операторов нет: тело просто копируется
+    bool buildTable(uchar min_v, uchar max_v, uchar* table) const noexcept;
+    // то же для 16-битных отсчётов до colors (buildRemapTable16)
+    bool buildTable16(size_t min_v, size_t max_v, uint16_t* table) const noexcept;
+
+    // 16-битная версия modify*: двухуровневая гистограмма и таблица на 65536 входов
+    void modifyWide(
+        const float coeff,
+        const int threads_count,
+        const string schedule_kind,
+        const int chunk_size
+    ) noexcept;
+
+    // гистограмма последнего modify* - живёт вместе с объектом, чтобы при
+    // повторном использовании PNMPicture (пакетный режим) не выделять её заново
+    vector<size_t> histogram;
+    // histogram посчитана по телу при разборе P2/P3 и ещё верна -
+    // сбрасывается, как только кто-то берёт targetData()
+    bool isHistogramParsed = false;
+
+    MappedFile inputMapping;
+    MappedFile outputMapping;
+    size_t inputHeaderSize = 0;
+    bool isMapped = false;
+    bool isInPlace = false;
 };
 
 
@@ -0,0 +1,333 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "pnm_ascii.h"
+#include "histogram_reduction.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+// меньше этого на поток делить текст невыгодно - поток дольше будить
+static constexpr size_t minParseRangeSize = 256 * 1024;
+// отсчётов на кусок при форматировании
+static constexpr size_t formatChunkSamples = 512 * 1024;
+static constexpr size_t maxLineLength = 70;
+
+static constexpr uint64_t repeatByte(uint8_t b) noexcept {
+    return 0x0101010101010101ull * b;
+}
+
+struct SpaceTable {
+    bool isSpace[256] = {false};
+
+    constexpr SpaceTable() {
+        isSpace[uchar(' ')] = true;
+        isSpace[uchar('\t')] = true;
+        isSpace[uchar('\n')] = true;
+        isSpace[uchar('\v')] = true;
+        isSpace[uchar('\f')] = true;
+        isSpace[uchar('\r')] = true;
+    }
+};
+
+static constexpr SpaceTable spaces;
+
+static inline bool isSpace(char c) noexcept {
+    return spaces.isSpace[uchar(c)];
+}
+
+// Все пробельные символы меньше '0', поэтому конец числа - первый байт меньше '0'.
+// У (w - 0x30..) & ~w старший бит первого такого байта выставлен точно: заём
+// приходит только из младших байтов, а они не меньше '0'. Дальше 1..7 цифр
+// сдвигаются в старшие байты (младшие становятся ведущими нулями) и сворачиваются
+// тремя умножениями: пары цифр, четвёрки, восьмёрка.
+// false - в слове нет конца числа (8 и больше символов) - пусть разбирает скалярный путь
+static inline bool parseWord(uint64_t w, uint32_t& value, size_t& digitsCount, bool& isValid) noexcept {
+    uint64_t below = (w - repeatByte('0')) & ~w & repeatByte(0x80);
+    if (below == 0) {
+        return false;
+    }
+
+    digitsCount = size_t(__builtin_ctzll(below)) >> 3;
+    if (digitsCount == 0) {
+        isValid = false;
+        return true;
+    }
+
+    uint64_t digits = w & (~0ull >> (64 - 8 * digitsCount));
+    // байты больше '9': после +0x46 у 0x3a..0x7f выставляется старший бит, у 0x80..0xff он уже есть
+    uint64_t above = (((digits & repeatByte(0x7f)) + repeatByte(0x46)) | digits) & repeatByte(0x80);
+    isValid = above == 0;
+
+    digits = (digits & repeatByte(0x0f)) << (64 - 8 * digitsCount);
+    digits = (digits * 2561) >> 8;
+    digits = ((digits & 0x00ff00ff00ff00ffull) * 6553601) >> 16;
+    value = uint32_t(((digits & 0x0000ffff0000ffffull) * 42949672960001ull) >> 32);
+    return true;
+}
+
+// разбор числа, начинающегося с text[pos]; на выходе pos - за последней цифрой
+static inline bool parseSample(const char* text, size_t length, size_t& pos, uint32_t& value) noexcept {
+    if (pos + 8 <= length) {
+        uint64_t w;
+        memcpy(&w, text + pos, 8);
+        size_t digitsCount = 0;
+        bool isValid = true;
+        if (parseWord(w, value, digitsCount, isValid)) {
+            pos += digitsCount;
+            // конец числа внутри слова - это должен быть пробел, а не '#' или '-'
+            return isValid && isSpace(text[pos]);
+        }
+    }
+
+    // хвост текста и длинные числа (ведущие нули): по цифре, с насыщением
+    size_t start = pos;
+    uint32_t result = 0;
+    while (pos < length && uchar(text[pos] - '0') < 10) {
+        result = min<uint32_t>(result * 10 + uint32_t(text[pos] - '0'), 1u << 20);
+        pos++;
+    }
+    value = result;
+    return pos != start && (pos == length || isSpace(text[pos]));
+}
+
+// число начал токенов в [start, end): start всегда пробел или начало текста
+static size_t countSamples(const char* text, size_t start, size_t end) noexcept {
+    size_t count = 0;
+    bool isPreviousSpace = true;
+    for (size_t i = start; i < end; i++) {
+        bool isCurrentSpace = isSpace(text[i]);
+        count += size_t(isPreviousSpace & !isCurrentSpace);
+        isPreviousSpace = isCurrentSpace;
+    }
+    return count;
+}
+
+// [0, count) кусками по одному; один поток или один кусок - прямо здесь, без общего пула:
+// такой разбор не ждёт чужих вызовов пула
+static void forEachRange(size_t count, int threads_count, const ThreadPool::RangeBody& body) {
+    if (threads_count <= 1 || count <= 1) {
+        body(0, count, 0);
+        return;
+    }
+    ThreadPool::shared(threads_count).parallelFor(count, "dynamic", 1, body);
+}
+
+// сколько потоков реально даст общий пул
+static int teamSize(int threads_count) {
+    return threads_count <= 1 ? 1 : ThreadPool::shared(threads_count).size();
+}
+
+void asciiParse(
+    const char* text,
+    size_t length,
+    uchar* d,
+    size_t samplesCount,
+    short bytesPerSample,
+    int maxValue,
+    int threads_count,
+    size_t* elements
+) {
+    if (elements != nullptr && bytesPerSample != 1) {
+        throw runtime_error("Histogram while parsing is supported only for 8-bit samples");
+    }
+
+    const size_t rangesCount = max<size_t>(1, min<size_t>(max(threads_count, 1), length / minParseRangeSize));
+    // границы кусков сдвигаются вперёд до пробела
+    vector<size_t> bounds(rangesCount + 1, length);
+    bounds[0] = 0;
+    for (size_t range = 1; range < rangesCount; range++) {
+        size_t bound = max(bounds[range - 1], length / rangesCount * range);
+        while (bound < length && !isSpace(text[bound])) {
+            bound++;
+        }
+        bounds[range] = bound;
+    }
+
+    const int threadsCount = teamSize(threads_count);
+
+    vector<size_t> offsets(rangesCount + 1, 0);
+    forEachRange(rangesCount, threadsCount, [text, &bounds, &offsets](size_t begin, size_t end, int) {
+        for (size_t range = begin; range < end; range++) {
+            offsets[range + 1] = countSamples(text, bounds[range], bounds[range + 1]);
+        }
+    });
+    for (size_t range = 0; range < rangesCount; range++) {
+        offsets[range + 1] += offsets[range];
+    }
+    if (offsets[rangesCount] < samplesCount) {
+        throw runtime_error("Not enough samples in ASCII PNM body");
+    }
+
+    atomic<bool> isFailed = false;
+    // куски раздаются динамически - гистограммы по потокам, а не по кускам
+    HistogramReduction<size_t> reduction(elements != nullptr ? threadsCount : 0, 256);
+
+    forEachRange(rangesCount, threadsCount, [&](size_t begin, size_t end, int thread_index) {
+        for (size_t range = begin; range < end; range++) {
+            if (offsets[range] >= samplesCount) {
+                continue;
+            }
+            const size_t firstSample = offsets[range];
+            const size_t lastSample = min(offsets[range + 1], samplesCount);
+
+            size_t pos = bounds[range];
+            uchar* out = d + firstSample * bytesPerSample;
+            size_t* els = nullptr;
+            if (elements != nullptr) {
+                els = reduction.row(thread_index);
+            }
+
+            bool isValid = true;
+            for (size_t sample = firstSample; sample < lastSample; sample++) {
+                while (isSpace(text[pos])) {
+                    pos++;
+                }
+                uint32_t value = 0;
+                isValid &= parseSample(text, length, pos, value);
+                isValid &= value <= uint32_t(maxValue);
+                if (!isValid) {
+                    break;
+                }
+
+                if (bytesPerSample == 1) {
+                    *out++ = uchar(value);
+                    if (els != nullptr) {
+                        els[value] += 1;
+                    }
+                } else {
+                    out[0] = uchar(value >> 8);
+                    out[1] = uchar(value);
+                    out += 2;
+                }
+            }
+            if (!isValid) {
+                isFailed = true;
+            }
+        }
+    });
+
+    if (isFailed) {
+        throw runtime_error("Invalid sample in ASCII PNM body");
+    }
+
+    if (elements != nullptr) {
+        reduction.reduce(elements, threadsCount);
+    }
+}
+
+// 8 бит: готовый текст каждого значения - копируем 4 байта, сдвигаемся на длину
+struct ByteTexts {
+    char text[256][4] = {};
+    uchar length[256] = {};
+
+    constexpr ByteTexts() {
+        for (int v = 0; v < 256; v++) {
+            int digitsCount = v >= 100 ? 3 : (v >= 10 ? 2 : 1);
+            int rest = v;
+            for (int i = digitsCount - 1; i >= 0; i--) {
+                text[v][i] = char('0' + rest % 10);
+                rest /= 10;
+            }
+            length[v] = uchar(digitsCount);
+        }
+    }
+};
+
+static constexpr ByteTexts byteTexts;
+
+struct DigitPairs {
+    char text[200] = {};
+
+    constexpr DigitPairs() {
+        for (int v = 0; v < 100; v++) {
+            text[2 * v] = char('0' + v / 10);
+            text[2 * v + 1] = char('0' + v % 10);
+        }
+    }
+};
+
+static constexpr DigitPairs digitPairs;
+
+// 16 бит: по две цифры за деление, справа налево во временный буфер
+static inline char* formatWide(uint32_t v, char* p) noexcept {
+    char digits[8];
+    char* end = digits + sizeof(digits);
+    char* q = end;
+    while (v >= 100) {
+        q -= 2;
+        memcpy(q, digitPairs.text + 2 * (v % 100), 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        q -= 2;
+        memcpy(q, digitPairs.text + 2 * v, 2);
+    } else {
+        *--q = char('0' + v);
+    }
+    size_t digitsCount = size_t(end - q);
+    memcpy(p, q, digitsCount);
+    return p + digitsCount;
+}
+
+void asciiWrite(
+    FILE* out,
+    const uchar* d,
+    size_t samplesCount,
+    short bytesPerSample,
+    int maxValue,
+    int threads_count
+) {
+    int maxDigits = 1;
+    for (int v = maxValue; v >= 10; v /= 10) {
+        maxDigits++;
+    }
+    // разделитель после каждого числа; перевод строки - каждые samplesPerLine отсчётов
+    const size_t samplesPerLine = max<size_t>(1, maxLineLength / (maxDigits + 1));
+    const size_t chunkSamples = formatChunkSamples / samplesPerLine * samplesPerLine;
+    const size_t chunksCount = (samplesCount + chunkSamples - 1) / chunkSamples;
+
+    const int threadsCount = teamSize(threads_count);
+    const size_t roundChunks = size_t(threadsCount);
+    // +4 - копирование 4 байт из ByteTexts может выйти за последнее число
+    vector<vector<char>> buffers(roundChunks, vector<char>(chunkSamples * (maxDigits + 1) + 4));
+    vector<size_t> lengths(roundChunks, 0);
+
+    for (size_t roundStart = 0; roundStart < chunksCount; roundStart += roundChunks) {
+        const size_t roundEnd = min(roundStart + roundChunks, chunksCount);
+
+        forEachRange(roundEnd - roundStart, threadsCount, [&](size_t begin, size_t end, int) {
+            for (size_t index = begin; index < end; index++) {
+                const size_t firstSample = (roundStart + index) * chunkSamples;
+                const size_t lastSample = min(firstSample + chunkSamples, samplesCount);
+                char* p = buffers[index].data();
+
+                for (size_t sample = firstSample; sample < lastSample; sample++) {
+                    if (bytesPerSample == 1) {
+                        uchar v = d[sample];
+                        memcpy(p, byteTexts.text[v], 4);
+                        p += byteTexts.length[v];
+                    } else {
+                        p = formatWide(uint32_t(d[2 * sample]) << 8 | d[2 * sample + 1], p);
+                    }
+                    bool isLineEnd = (sample + 1) % samplesPerLine == 0 || sample + 1 == samplesCount;
+                    *p++ = isLineEnd ? '\n' : ' ';
+                }
+                lengths[index] = size_t(p - buffers[index].data());
+            }
+        });
+
+        for (size_t index = 0; index < roundEnd - roundStart; index++) {
+            if (fwrite(buffers[index].data(), 1, lengths[index], out) != lengths[index]) {
+                throw runtime_error("Error while trying to write to file");
+            }
+        }
+    }
+}
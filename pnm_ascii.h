@@ -0,0 +1,47 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_PNM_ASCII_H
+#define TESTPROJECT_PNM_ASCII_H
+
+#include <cstddef>
+#include <cstdio>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Тело ASCII PNM (P2/P3) - десятичные отсчёты через пробельные символы.
+// Текст делится на куски по потокам, границы сдвигаются до ближайшего пробела,
+// чтобы ни одно число не разрезалось. Первый проход считает числа в каждом куске
+// (отсюда смещения в d), второй разбирает их: до 8 цифр за раз через SWAR.
+// Отсчёты пишутся в том же виде, что и тело P5/P6: байт или big-endian пара байт.
+// elements != nullptr (только bytesPerSample == 1) - заодно копится гистограмма
+// из 256 корзин, отдельный проход по телу не нужен.
+// Бросает runtime_error на посторонних символах, отсчётах больше maxValue и
+// нехватке отсчётов; лишние отсчёты в конце игнорируются
+void asciiParse(
+    const char* text,
+    size_t length,
+    uchar* d,
+    size_t samplesCount,
+    short bytesPerSample,
+    int maxValue,
+    int threads_count,
+    size_t* elements
+);
+
+// Форматирует samplesCount отсчётов d в out: строки не длиннее 70 символов,
+// как у netpbm. Куски форматируются потоками параллельно в свои буферы
+// и пишутся по порядку; памяти - не больше нескольких МБ на поток
+void asciiWrite(
+    FILE* out,
+    const uchar* d,
+    size_t samplesCount,
+    short bytesPerSample,
+    int maxValue,
+    int threads_count
+);
+
+#endif //TESTPROJECT_PNM_ASCII_H
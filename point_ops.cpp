@@ -0,0 +1,141 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "point_ops.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+static vector<double> parseParameters(const string& name, stringstream& stream, size_t count) {
+    vector<double> parameters;
+    string part;
+    while (getline(stream, part, ':')) {
+        size_t parsed = 0;
+        try {
+            parameters.push_back(stod(part, &parsed));
+        } catch (exception&) {
+            parsed = 0;
+        }
+        if (parsed == 0 || parsed != part.size()) {
+            throw runtime_error("Invalid parameter " + part + " of operator " + name);
+        }
+    }
+    if (parameters.size() != count) {
+        throw runtime_error("Operator " + name + " expects " + to_string(count) + " parameters");
+    }
+    return parameters;
+}
+
+vector<PointOp> parsePointOps(const string& spec) {
+    vector<PointOp> ops;
+    stringstream specStream(spec);
+    string item;
+    while (getline(specStream, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        stringstream stream(item);
+        string name;
+        getline(stream, name, ':');
+
+        PointOp op;
+        if (name == "gamma") {
+            op.kind = PointOpKind::Gamma;
+            op.first = parseParameters(name, stream, 1)[0];
+            if (!(op.first > 0)) {
+                throw runtime_error("Gamma must be positive");
+            }
+        } else if (name == "invert") {
+            op.kind = PointOpKind::Invert;
+            parseParameters(name, stream, 0);
+        } else if (name == "levels") {
+            op.kind = PointOpKind::Levels;
+            vector<double> parameters = parseParameters(name, stream, 2);
+            op.first = parameters[0];
+            op.second = parameters[1];
+            if (op.first < 0 || op.second > 255 || op.first >= op.second) {
+                throw runtime_error("Levels must be 0 <= low < high <= 255");
+            }
+        } else if (name == "threshold") {
+            op.kind = PointOpKind::Threshold;
+            op.first = parseParameters(name, stream, 1)[0];
+            if (op.first < 0 || op.first > 255) {
+                throw runtime_error("Threshold must be in 0..255");
+            }
+        } else {
+            throw runtime_error("Unsupported operator " + name + ", expected gamma|invert|levels|threshold");
+        }
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+// таблица одного оператора на все значения 0..maxValue
+static void buildOpTable(const PointOp& op, size_t maxValue, vector<uint16_t>& opTable) noexcept {
+    const double top = double(maxValue);
+    // параметры заданы в шкале 0..255
+    const double scale = top / 255;
+    opTable.resize(maxValue + 1);
+    for (size_t v = 0; v <= maxValue; v++) {
+        double value = double(v);
+        switch (op.kind) {
+            case PointOpKind::Gamma:
+                value = top * pow(value / top, 1 / op.first);
+                break;
+            case PointOpKind::Invert:
+                value = top - value;
+                break;
+            case PointOpKind::Levels: {
+                const double low = op.first * scale;
+                const double high = op.second * scale;
+                value = (value - low) * top / (high - low);
+                break;
+            }
+            case PointOpKind::Threshold:
+                value = value >= op.first * scale ? top : 0;
+                break;
+        }
+        opTable[v] = uint16_t(clamp(lround(value), 0L, long(maxValue)));
+    }
+}
+
+void composePointOps(const vector<PointOp>& ops, uchar* table) noexcept {
+    vector<uint16_t> opTable;
+    for (const auto& op : ops) {
+        buildOpTable(op, 255, opTable);
+        for (int v = 0; v < 256; v++) {
+            table[v] = uchar(opTable[table[v]]);
+        }
+    }
+}
+
+void composePointOps16(const vector<PointOp>& ops, size_t maxValue, uint16_t* table) noexcept {
+    if (ops.empty()) {
+        return;
+    }
+    // в таблице значения уже в порядке байт файла - раскладываем, сворачиваем и собираем обратно
+    vector<uint16_t> values(65536);
+    for (size_t v = 0; v < 65536; v++) {
+        uchar bytes[2];
+        memcpy(bytes, &table[v], 2);
+        values[v] = uint16_t((bytes[0] << 8) | bytes[1]);
+    }
+
+    vector<uint16_t> opTable;
+    for (const auto& op : ops) {
+        buildOpTable(op, maxValue, opTable);
+        for (auto& value : values) {
+            value = opTable[min<size_t>(value, maxValue)];
+        }
+    }
+
+    for (size_t v = 0; v < 65536; v++) {
+        uchar bytes[2] = {uchar(values[v] >> 8), uchar(values[v] & 0xff)};
+        memcpy(&table[v], bytes, 2);
+    }
+}
@@ -0,0 +1,50 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_POINT_OPS_H
+#define TESTPROJECT_POINT_OPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Поточечные операторы после растяжения: значение пикселя зависит только от
+// его же значения, поэтому вся цепочка сворачивается в ту же таблицу remap и
+// выполняется одним проходом по памяти - N операторов стоят столько же, сколько один.
+// Каждый оператор сам округляет результат до целого, так что свёрнутая таблица
+// даёт побитово то же, что N отдельных проходов.
+// Параметры levels и threshold - в шкале 0..255 и для 16-битных изображений
+// масштабируются к maxval: одна цепочка годится для файлов любой глубины
+enum class PointOpKind {
+    // gamma:g - v = max * (v / max)^(1 / g), g > 1 осветляет
+    Gamma,
+    // invert - v = max - v
+    Invert,
+    // levels:low:high - [low, high] растягивается на весь диапазон с клэмпом
+    Levels,
+    // threshold:t - v >= t ? max : 0
+    Threshold
+};
+
+struct PointOp {
+    PointOpKind kind;
+    double first = 0;
+    double second = 0;
+};
+
+// "gamma:2.2,invert,levels:16:240,threshold:128" - операторы в порядке применения;
+// runtime_error на неизвестном операторе или некорректных параметрах
+vector<PointOp> parsePointOps(const string& spec);
+
+// table[v] = op_n(...op_1(table[v])) для таблицы buildRemapTable (или тождественной)
+void composePointOps(const vector<PointOp>& ops, uchar* table) noexcept;
+// то же для таблицы buildRemapTable16: значения 0..maxValue в big-endian порядке байт
+void composePointOps16(const vector<PointOp>& ops, size_t maxValue, uint16_t* table) noexcept;
+
+#endif //TESTPROJECT_POINT_OPS_H
@@ -0,0 +1,124 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "quantile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+void determineQuantiles(
+    size_t ignoreCount,
+    size_t totalCount,
+    const size_t* elements,
+    size_t binsCount,
+    size_t& min_v,
+    size_t& max_v
+) noexcept {
+    const size_t rank = max(ignoreCount, size_t(1));
+    if (rank > totalCount) {
+        return;
+    }
+
+    size_t darkCount = 0;
+    for (size_t i = 0; i < binsCount; i++) {
+        darkCount += elements[i];
+        if (darkCount >= rank) {
+            min_v = i;
+            break;
+        }
+    }
+
+    size_t brightCount = 0;
+    for (size_t i = binsCount; i > 0; i--) {
+        brightCount += elements[i - 1];
+        if (brightCount >= rank) {
+            max_v = i - 1;
+            break;
+        }
+    }
+}
+
+// splitmix64 - дешёвый генератор с хорошим перемешиванием соседних seed
+static inline uint64_t mix(uint64_t x) noexcept {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void sampleAccumulate(
+    const uchar* d,
+    size_t size,
+    size_t strataCount,
+    size_t firstStratum,
+    size_t lastStratum,
+    size_t* elements
+) noexcept {
+    for (size_t stratum = firstStratum; stratum < lastStratum; stratum++) {
+        // u из [0, 1): позиция равномерна внутри дробной страты [stratum, stratum + 1) * size / strataCount
+        double u = double(mix(stratum) >> 11) * 0x1p-53;
+        size_t position = size_t((double(stratum) + u) * double(size) / double(strataCount));
+        elements[d[min(position, size - 1)]] += 1;
+    }
+}
+
+double quantileErrorBound(size_t sampleCount, double failureProbability) noexcept {
+    return sqrt(log(8 / failureProbability) / (2 * double(sampleCount)));
+}
+
+// Корзина, в которую попадает значение с долей target в эмпирической функции
+// распределения F_n. Истинная F в границах отличается от F_n не больше чем на eps, поэтому
+// корзина b точная, если F_n(b - 1) + eps < target <= F_n(b) - eps
+static bool estimateBin(
+    const size_t* sample,
+    size_t sampleCount,
+    size_t binsCount,
+    double target,
+    double eps,
+    size_t& bin
+) noexcept {
+    size_t count = 0;
+    for (size_t i = 0; i < binsCount; i++) {
+        double below = double(count) / double(sampleCount);
+        count += sample[i];
+        double through = double(count) / double(sampleCount);
+        if (through >= target) {
+            bin = i;
+            return below + eps < target && target <= through - eps;
+        }
+    }
+    return false;
+}
+
+bool estimateQuantiles(
+    size_t ignoreCount,
+    size_t totalCount,
+    const size_t* sample,
+    size_t sampleCount,
+    size_t binsCount,
+    double errorBound,
+    size_t& min_v,
+    size_t& max_v
+) noexcept {
+    const size_t rank = max(ignoreCount, size_t(1));
+    if (sampleCount == 0 || rank > totalCount) {
+        return false;
+    }
+
+    // min_v: C(b - 1) < rank <= C(b); max_v: C(b - 1) < N - rank + 1 <= C(b)
+    double darkTarget = double(rank) / double(totalCount);
+    double brightTarget = double(totalCount - rank + 1) / double(totalCount);
+
+    size_t darkBin;
+    size_t brightBin;
+    if (!estimateBin(sample, sampleCount, binsCount, darkTarget, errorBound, darkBin) ||
+        !estimateBin(sample, sampleCount, binsCount, brightTarget, errorBound, brightBin)) {
+        return false;
+    }
+    min_v = darkBin;
+    max_v = brightBin;
+    return true;
+}
@@ -0,0 +1,61 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_QUANTILE_H
+#define TESTPROJECT_QUANTILE_H
+
+#include <cstddef>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Приближённые границы растяжения по случайной выборке вместо полной гистограммы.
+// Границы - порядковые статистики: min_v - значение ранга k = max(ignoreCount, 1),
+// max_v - ранга N - k + 1, т.е. с каждой стороны отбрасывается ignoreCount значений.
+
+// Симметричные границы по точной гистограмме (используется и как запасной путь оценки)
+void determineQuantiles(
+    size_t ignoreCount,
+    size_t totalCount,
+    const size_t* elements,
+    size_t binsCount,
+    size_t& min_v,
+    size_t& max_v
+) noexcept;
+
+// Стратифицированная выборка: [0, size) делится на strataCount равных (дробных) страт,
+// из страт [firstStratum, lastStratum) берётся по одному байту в равномерно случайной
+// позиции. Каждый байт изображения попадает в выборку с одинаковой вероятностью, а страты
+// независимы. Позиции зависят только от номера страты - результат не зависит от числа потоков
+void sampleAccumulate(
+    const uchar* d,
+    size_t size,
+    size_t strataCount,
+    size_t firstStratum,
+    size_t lastStratum,
+    size_t* elements
+) noexcept;
+
+// Граница ошибки эмпирической функции распределения: неравенство Хёфдинга
+// для независимых страт и объединение по четырём точкам, которые проверяет
+// estimateQuantiles. С вероятностью не меньше 1 - failureProbability во всех
+// четырёх |F(x) - F_n(x)| <= eps
+double quantileErrorBound(size_t sampleCount, double failureProbability) noexcept;
+
+// Оценивает границы determineQuantiles по гистограмме выборки sample из sampleCount значений.
+// Возвращает false, если хотя бы одна граница попадает ближе errorBound к краю корзины -
+// тогда корзина по выборке не определяется и нужна точная гистограмма
+bool estimateQuantiles(
+    size_t ignoreCount,
+    size_t totalCount,
+    const size_t* sample,
+    size_t sampleCount,
+    size_t binsCount,
+    double errorBound,
+    size_t& min_v,
+    size_t& max_v
+) noexcept;
+
+#endif //TESTPROJECT_QUANTILE_H
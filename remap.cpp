@@ -0,0 +1,228 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "remap.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REMAP_X86
+#endif
+
+using namespace std;
+
+void buildRemapTable(uchar min_v, uchar max_v, uchar* table) noexcept {
+    float const scale = 255 / float(max_v - min_v);
+    float scaledMinV = scale * float(min_v);
+
+    for (int v = 0; v < 256; v++) {
+        int scaledValue = int(scale * float(v) - scaledMinV);
+        table[v] = max(0, min(scaledValue, 255));
+    }
+}
+
+static void remapTail(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept {
+    for (size_t i = 0; i < size; i++) {
+        d[i] = table[s[i]];
+    }
+}
+
+static size_t remapScalar(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        uchar v0 = table[s[i]];
+        uchar v1 = table[s[i + 1]];
+        uchar v2 = table[s[i + 2]];
+        uchar v3 = table[s[i + 3]];
+        d[i] = v0;
+        d[i + 1] = v1;
+        d[i + 2] = v2;
+        d[i + 3] = v3;
+    }
+    return i;
+}
+
+#ifdef REMAP_X86
+
+// vpermi2b ищет сразу в 128 байтах двух регистров - на всю таблицу хватает двух
+// перестановок и смешивания по старшему биту индекса
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static size_t remapAvx512(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept {
+    const __m512i t0 = _mm512_loadu_si512((const void*)table);
+    const __m512i t1 = _mm512_loadu_si512((const void*)(table + 64));
+    const __m512i t2 = _mm512_loadu_si512((const void*)(table + 128));
+    const __m512i t3 = _mm512_loadu_si512((const void*)(table + 192));
+
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i x = _mm512_loadu_si512((const void*)(s + i));
+        __m512i low = _mm512_permutex2var_epi8(t0, x, t1);
+        __m512i high = _mm512_permutex2var_epi8(t2, x, t3);
+        __mmask64 isHigh = _mm512_movepi8_mask(x);
+        _mm512_storeu_si512((void*)(d + i), _mm512_mask_blend_epi8(isHigh, low, high));
+    }
+    return i;
+}
+
+#endif
+
+typedef size_t (*RemapBlockKernel)(const uchar*, uchar*, size_t, const uchar*) noexcept;
+
+struct RemapKernel {
+    RemapBlockKernel block;
+    const char* name;
+};
+
+static RemapKernel selectKernel() noexcept {
+#ifdef REMAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        return {remapAvx512, "avx512vbmi"};
+    }
+#endif
+    return {remapScalar, "scalar"};
+}
+
+static const RemapKernel& kernel() noexcept {
+    static const RemapKernel selected = selectKernel();
+    return selected;
+}
+
+void remapApply(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept {
+    size_t processed = kernel().block(s, d, size, table);
+    remapTail(s + processed, d + processed, size - processed, table);
+}
+
+void remapApplyScalar(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept {
+    size_t processed = remapScalar(s, d, size, table);
+    remapTail(s + processed, d + processed, size - processed, table);
+}
+
+static void remapRgbTail(const uchar* s, uchar* d, size_t size, const uchar* tables) noexcept {
+    // хвост всегда начинается с границы пикселя
+    for (size_t i = 0; i < size; i++) {
+        d[i] = tables[256 * (i % 3) + s[i]];
+    }
+}
+
+static size_t remapRgbScalar(const uchar* s, uchar* d, size_t size, const uchar* tables) noexcept {
+    const uchar* r = tables;
+    const uchar* g = tables + 256;
+    const uchar* b = tables + 512;
+    size_t i = 0;
+    for (; i + 6 <= size; i += 6) {
+        uchar v0 = r[s[i]];
+        uchar v1 = g[s[i + 1]];
+        uchar v2 = b[s[i + 2]];
+        uchar v3 = r[s[i + 3]];
+        uchar v4 = g[s[i + 4]];
+        uchar v5 = b[s[i + 5]];
+        d[i] = v0;
+        d[i + 1] = v1;
+        d[i + 2] = v2;
+        d[i + 3] = v3;
+        d[i + 4] = v4;
+        d[i + 5] = v5;
+    }
+    return i;
+}
+
+#ifdef REMAP_X86
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static size_t remapRgbAvx512(const uchar* s, uchar* d, size_t size, const uchar* tables) noexcept {
+    __m512i parts[3][4];
+    for (int channel = 0; channel < 3; channel++) {
+        for (int k = 0; k < 4; k++) {
+            parts[channel][k] = _mm512_loadu_si512((const void*)(tables + 256 * channel + 64 * k));
+        }
+    }
+    // 192 байта = 3 вектора по 64
+    __mmask64 channelMasks[3][3] = {};
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 64; i++) {
+            channelMasks[j][(64 * j + i) % 3] |= __mmask64(1) << i;
+        }
+    }
+
+    size_t i = 0;
+    for (; i + 192 <= size; i += 192) {
+        for (int j = 0; j < 3; j++) {
+            __m512i x = _mm512_loadu_si512((const void*)(s + i + 64 * j));
+            __mmask64 isHigh = _mm512_movepi8_mask(x);
+
+            __m512i result = _mm512_setzero_si512();
+            for (int channel = 0; channel < 3; channel++) {
+                __m512i low = _mm512_permutex2var_epi8(parts[channel][0], x, parts[channel][1]);
+                __m512i high = _mm512_permutex2var_epi8(parts[channel][2], x, parts[channel][3]);
+                __m512i value = _mm512_mask_blend_epi8(isHigh, low, high);
+                result = _mm512_mask_blend_epi8(channelMasks[j][channel], result, value);
+            }
+            _mm512_storeu_si512((void*)(d + i + 64 * j), result);
+        }
+    }
+    return i;
+}
+
+#endif
+
+static RemapKernel selectRgbKernel() noexcept {
+#ifdef REMAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        return {remapRgbAvx512, "avx512vbmi"};
+    }
+#endif
+    return {remapRgbScalar, "scalar"};
+}
+
+void remapApplyRgb(const uchar* s, uchar* d, size_t pixelsCount, const uchar* tables) noexcept {
+    static const RemapKernel selected = selectRgbKernel();
+
+    size_t size = pixelsCount * 3;
+    size_t processed = selected.block(s, d, size, tables);
+    remapRgbTail(s + processed, d + processed, size - processed, tables);
+}
+
+void remapApplyRgbScalar(const uchar* s, uchar* d, size_t pixelsCount, const uchar* tables) noexcept {
+    size_t size = pixelsCount * 3;
+    size_t processed = remapRgbScalar(s, d, size, tables);
+    remapRgbTail(s + processed, d + processed, size - processed, tables);
+}
+
+void buildRemapTable16(size_t min_v, size_t max_v, size_t maxValue, uint16_t* table) noexcept {
+    double const scale = double(maxValue) / double(max_v - min_v);
+    double scaledMinV = scale * double(min_v);
+
+    for (size_t v = 0; v < 65536; v++) {
+        long scaledValue = long(scale * double(v) - scaledMinV);
+        uint16_t value = uint16_t(max(0L, min(scaledValue, long(maxValue))));
+        // байты результата в памяти - сразу в порядке файла
+        uchar bytes[2] = {uchar(value >> 8), uchar(value & 0xff)};
+        memcpy(&table[v], bytes, 2);
+    }
+}
+
+void remapApply16(const uchar* s, uchar* d, size_t samplesCount, const uint16_t* table) noexcept {
+    size_t i = 0;
+    for (; i + 4 <= samplesCount; i += 4) {
+        uint16_t v0 = table[(s[2 * i] << 8) | s[2 * i + 1]];
+        uint16_t v1 = table[(s[2 * i + 2] << 8) | s[2 * i + 3]];
+        uint16_t v2 = table[(s[2 * i + 4] << 8) | s[2 * i + 5]];
+        uint16_t v3 = table[(s[2 * i + 6] << 8) | s[2 * i + 7]];
+        memcpy(d + 2 * i, &v0, 2);
+        memcpy(d + 2 * i + 2, &v1, 2);
+        memcpy(d + 2 * i + 4, &v2, 2);
+        memcpy(d + 2 * i + 6, &v3, 2);
+    }
+    for (; i < samplesCount; i++) {
+        uint16_t v = table[(s[2 * i] << 8) | s[2 * i + 1]];
+        memcpy(d + 2 * i, &v, 2);
+    }
+}
+
+const char* remapKernelName() noexcept {
+    return kernel().name;
+}
@@ -0,0 +1,46 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_REMAP_H
+#define TESTPROJECT_REMAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+typedef unsigned char uchar;
+
+// Входных значений всего 256, поэтому растяжение int(scale * v - scaledMinV)
+// с клэмпом считается один раз в таблицу, а дальше каждый байт - это lookup.
+// Все бэкенды строят таблицу одной функцией - результат побитово совпадает.
+void buildRemapTable(uchar min_v, uchar max_v, uchar* table) noexcept;
+
+// d[i] = table[s[i]] для i из [0, size); s и d могут совпадать.
+// Реализация выбирается один раз при первом вызове: AVX-512 VBMI или скалярная.
+// pshufb-варианты (SSSE3/AVX2) ищут в 16 частях таблицы по очереди и на
+// contrast_bench --remap не быстрее скалярной таблицы - их нет
+void remapApply(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept;
+// то же всегда скалярной реализацией - для бэкенда scalar
+void remapApplyScalar(const uchar* s, uchar* d, size_t size, const uchar* table) noexcept;
+
+// Поканальный remap чередующихся RGB-пикселей за один проход:
+// tables[0..256) - R, [256..512) - G, [512..768) - B.
+// Вместо деинтерлива в каждом векторе ищем по всем трём таблицам и смешиваем
+// результаты по маскам каналов - у 192-байтового блока они фиксированы
+void remapApplyRgb(const uchar* s, uchar* d, size_t pixelsCount, const uchar* tables) noexcept;
+// то же всегда скалярной реализацией - для сравнения в contrast_bench
+void remapApplyRgbScalar(const uchar* s, uchar* d, size_t pixelsCount, const uchar* tables) noexcept;
+
+// 16-битные отсчёты: та же формула, но до maxValue и в double - у float
+// на значениях порядка 65535 * 65535 не хватает точности.
+// Таблица на 65536 входов хранит результат уже в big-endian порядке байт
+void buildRemapTable16(size_t min_v, size_t max_v, size_t maxValue, uint16_t* table) noexcept;
+// samplesCount big-endian отсчётов из s через таблицу buildRemapTable16 в d; s и d могут совпадать
+void remapApply16(const uchar* s, uchar* d, size_t samplesCount, const uint16_t* table) noexcept;
+
+// имя выбранной реализации - для логов и CSV
+const char* remapKernelName() noexcept;
+
+#endif //TESTPROJECT_REMAP_H
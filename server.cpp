@@ -0,0 +1,301 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "server.h"
+#include "batch.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// задержки последних заданий для перцентилей - кольцевой буфер
+static constexpr size_t latencyWindow = 4096;
+
+class ServerStats {
+public:
+    void add(double latency, size_t bytes, bool isFailed) {
+        lock_guard<mutex> guard(lock);
+        jobsCount++;
+        if (isFailed) {
+            failedCount++;
+        }
+        bytesCount += bytes;
+        if (latencies.size() < latencyWindow) {
+            latencies.push_back(latency);
+        } else {
+            latencies[jobsCount % latencyWindow] = latency;
+        }
+    }
+
+    string report() {
+        lock_guard<mutex> guard(lock);
+        double uptime = max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-9);
+        vector<double> sorted = latencies;
+        sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (double latency : sorted) {
+            sum += latency;
+        }
+        auto percentile = [&sorted](double p) {
+            if (sorted.empty()) {
+                return 0.0;
+            }
+            size_t index = size_t(ceil(p * double(sorted.size()))) - 1;
+            return sorted[min(index, sorted.size() - 1)];
+        };
+
+        char text[512];
+        snprintf(text, sizeof(text),
+                 "OK jobs=%zu failed=%zu bytes=%zu uptime_s=%lg jobs_per_s=%lg mb_per_s=%lg "
+                 "latency_mean_ms=%lg latency_p50_ms=%lg latency_p95_ms=%lg latency_max_ms=%lg",
+                 jobsCount, failedCount, bytesCount, uptime, double(jobsCount) / uptime,
+                 double(bytesCount) / uptime / 1e6, sorted.empty() ? 0 : sum / double(sorted.size()),
+                 percentile(0.5), percentile(0.95), percentile(1));
+        return text;
+    }
+
+private:
+    mutex lock;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    size_t jobsCount = 0;
+    size_t failedCount = 0;
+    size_t bytesCount = 0;
+    vector<double> latencies;
+};
+
+static vector<string> splitLines(const string& message) {
+    vector<string> lines;
+    size_t start = 0;
+    while (start <= message.size()) {
+        size_t end = message.find('\n', start);
+        if (end == string::npos) {
+            end = message.size();
+        }
+        lines.push_back(message.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+struct ServerContext {
+    int listenSocket = -1;
+    int threads_count = 1;
+    size_t largeImageSize = 0;
+    vector<PointOp> pointOps;
+    atomic<bool> isStopping = false;
+    // открытые соединения - SHUTDOWN будит и потоки, ждущие в recvmsg
+    mutex connectionsLock;
+    unordered_set<int> connections;
+    PicturePool picturePool;
+    ServerStats stats;
+};
+
+static void modifyPicture(ServerContext& context, PNMPicture& picture, float coeff) {
+    if (coeff < 0 || coeff >= 0.5) {
+        throw runtime_error("coeff must be in range [0, 0.5)");
+    }
+    // маленькие задания - целиком в потоке соединения: modify и 16-битный modifyWide(..., 1, ...)
+    // берут у общего пула команду из одного потока, а она выполняется на месте,
+    // не ждёт чужих заданий и размер пула не меняет
+    if (picture.data_size >= context.largeImageSize) {
+        picture.modifyParallelCpp(coeff, context.threads_count, "static", 0);
+    } else {
+        picture.modify(coeff);
+    }
+}
+
+// задание FILE или SHM; возвращает ответ клиенту
+static string processJob(ServerContext& context, const vector<string>& lines, int fd) {
+    auto start = chrono::steady_clock::now();
+    auto picture = context.picturePool.acquire();
+    string reply;
+    size_t bytes = 0;
+    bool isFailed = false;
+
+    // разбор и запись P2/P3 - на потоках сервера; маленький текст разбирается
+    // одним куском прямо в потоке соединения (см. asciiParse)
+    picture->asciiThreadsCount = context.threads_count;
+    picture->pointOps = context.pointOps;
+    try {
+        const string& command = lines[0];
+        float coeff = stof(command.substr(command.find(' ') + 1));
+        if (command.rfind("FILE ", 0) == 0) {
+            if (lines.size() < 3) {
+                throw runtime_error("FILE expects input and output paths");
+            }
+            picture->read(lines[1]);
+            modifyPicture(context, *picture, coeff);
+            picture->write(lines[2]);
+        } else {
+            if (fd < 0) {
+                throw runtime_error("SHM expects a memfd descriptor");
+            }
+            // дескриптор теперь принадлежит отображению
+            picture->readMapped(fd);
+            fd = -1;
+            modifyPicture(context, *picture, coeff);
+            picture->closeMapped();
+        }
+        bytes = picture->data_size;
+    } catch (exception& e) {
+        reply = string("ERROR ") + e.what();
+        isFailed = true;
+        picture = make_unique<PNMPicture>();
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    context.picturePool.release(std::move(picture));
+
+    double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    context.stats.add(latency, bytes, isFailed);
+    if (!isFailed) {
+        char text[64];
+        snprintf(text, sizeof(text), "OK %lg", latency);
+        reply = text;
+    }
+    return reply;
+}
+
+// SHUT_RD: recvmsg вернёт 0 и соединение закроется после текущего ответа, а сам ответ,
+// в том числе "OK" на SHUTDOWN, ещё уходит
+static void stopServer(ServerContext& context) {
+    lock_guard<mutex> guard(context.connectionsLock);
+    context.isStopping = true;
+    // будит все потоки, ждущие в accept
+    shutdown(context.listenSocket, SHUT_RDWR);
+    for (int connection : context.connections) {
+        shutdown(connection, SHUT_RD);
+    }
+}
+
+static void serveConnection(ServerContext& context, int connection) {
+    {
+        lock_guard<mutex> guard(context.connectionsLock);
+        context.connections.insert(connection);
+        // принято уже после SHUTDOWN - закрывается, не дожидаясь команд
+        if (context.isStopping) {
+            shutdown(connection, SHUT_RD);
+        }
+    }
+
+    string message;
+    int fd;
+    while (receiveMessage(connection, message, fd)) {
+        vector<string> lines = splitLines(message);
+        const string& command = lines[0];
+        string reply;
+
+        if (command.rfind("FILE ", 0) == 0 || command.rfind("SHM ", 0) == 0) {
+            reply = processJob(context, lines, fd);
+            fd = -1;
+        } else if (command == "STATS") {
+            reply = context.stats.report();
+        } else if (command == "SHUTDOWN") {
+            stopServer(context);
+            reply = "OK";
+        } else {
+            reply = "ERROR unknown command " + command;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (!sendMessage(connection, reply, -1)) {
+            break;
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(context.connectionsLock);
+        context.connections.erase(connection);
+    }
+    close(connection);
+}
+
+// Удаляет только сокет, оставшийся от упавшего сервера: обычный файл по этому пути
+// не трогается, а к живому сокету кто-то ещё подключён как сервер
+static void removeStaleSocket(const string& socketPath, const sockaddr_un& address) {
+    struct stat info;
+    if (lstat(socketPath.c_str(), &info) != 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw runtime_error("Error while trying to stat " + socketPath);
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        throw runtime_error(socketPath + " exists and is not a socket");
+    }
+
+    int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        throw runtime_error("Error while trying to create server socket");
+    }
+    bool isAlive = connect(probe, (const sockaddr*)&address, sizeof(address)) == 0;
+    close(probe);
+    if (isAlive) {
+        throw runtime_error("Another server is already listening on " + socketPath);
+    }
+    if (unlink(socketPath.c_str()) != 0 && errno != ENOENT) {
+        throw runtime_error("Error while trying to remove stale socket " + socketPath);
+    }
+}
+
+int runServer(const string& socketPath, const int threads_count, const size_t largeImageSize,
+              const vector<PointOp>& point_ops) {
+    ServerContext context;
+    context.threads_count = max(threads_count, 1);
+    context.largeImageSize = largeImageSize;
+    context.pointOps = point_ops;
+
+    sockaddr_un address = socketAddress(socketPath);
+    context.listenSocket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (context.listenSocket < 0) {
+        throw runtime_error("Error while trying to create server socket");
+    }
+    removeStaleSocket(socketPath, address);
+    if (bind(context.listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(context.listenSocket, SOMAXCONN) != 0) {
+        close(context.listenSocket);
+        throw runtime_error("Error while trying to listen on " + socketPath);
+    }
+
+    // пул создаётся до первого задания - потоки уже ждут работу
+    ThreadPool::shared(context.threads_count);
+
+    vector<thread> acceptors;
+    for (int i = 0; i < context.threads_count; i++) {
+        acceptors.emplace_back([&context]() {
+            while (!context.isStopping) {
+                int connection = accept4(context.listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+                if (connection < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED) {
+                        continue;
+                    }
+                    break;
+                }
+                serveConnection(context, connection);
+            }
+        });
+    }
+    for (auto& acceptor : acceptors) {
+        acceptor.join();
+    }
+
+    close(context.listenSocket);
+    unlink(socketPath.c_str());
+    return 0;
+}
@@ -0,0 +1,26 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_SERVER_H
+#define TESTPROJECT_SERVER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "point_ops.h"
+#include "server_protocol.h"
+
+using namespace std;
+
+// Слушает socketPath, пока не придёт SHUTDOWN. Сокет, оставшийся от упавшего сервера,
+// удаляется; обычный файл или сокет живого сервера по этому пути - runtime_error.
+// threads_count потоков заранее ждут соединений в accept, общий пул процесса
+// создаётся сразу, задания берут из него по threads_count потоков.
+// Файлы с телом меньше largeImageSize обрабатываются однопоточно в потоке соединения,
+// большие - на всём пуле. point_ops - операторы после растяжения каждого задания.
+// Протокол - в server_protocol.h
+int runServer(const string& socketPath, const int threads_count, const size_t largeImageSize,
+              const vector<PointOp>& point_ops = {});
+
+#endif //TESTPROJECT_SERVER_H
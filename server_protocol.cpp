@@ -0,0 +1,94 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "server_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+// одно сообщение и, если пришёл, дескриптор из SCM_RIGHTS; false - соединение закрыто
+bool receiveMessage(int socket, string& message, int& fd) {
+    char buffer[server_constants::maxMessageSize];
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    iovec io{buffer, sizeof(buffer)};
+    msghdr header{};
+    header.msg_iov = &io;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    ssize_t length;
+    do {
+        length = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+    } while (length < 0 && errno == EINTR);
+    if (length <= 0) {
+        return false;
+    }
+    message.assign(buffer, size_t(length));
+
+    fd = -1;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&header); c != nullptr; c = CMSG_NXTHDR(&header, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+            memcpy(&fd, CMSG_DATA(c), sizeof(int));
+        }
+    }
+    return true;
+}
+
+bool sendMessage(int socket, const string& message, int fd) {
+    iovec io{const_cast<char*>(message.data()), message.size()};
+    msghdr header{};
+    header.msg_iov = &io;
+    header.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0) {
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+        cmsghdr* c = CMSG_FIRSTHDR(&header);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    }
+    return sendmsg(socket, &header, MSG_NOSIGNAL) == ssize_t(message.size());
+}
+
+sockaddr_un socketAddress(const string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Socket path is too long");
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return address;
+}
+
+string serverRequest(const string& socketPath, const string& request, int fd) {
+    sockaddr_un address = socketAddress(socketPath);
+    int connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (connection < 0) {
+        throw runtime_error("Error while trying to create client socket");
+    }
+    if (connect(connection, (const sockaddr*)&address, sizeof(address)) != 0) {
+        close(connection);
+        throw runtime_error("Error while trying to connect to " + socketPath);
+    }
+
+    string reply;
+    int replyFd = -1;
+    bool isOk = sendMessage(connection, request, fd) && receiveMessage(connection, reply, replyFd);
+    if (replyFd >= 0) {
+        close(replyFd);
+    }
+    close(connection);
+    if (!isOk) {
+        throw runtime_error("Error while talking to server");
+    }
+    return reply;
+}
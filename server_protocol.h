@@ -0,0 +1,39 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_SERVER_PROTOCOL_H
+#define TESTPROJECT_SERVER_PROTOCOL_H
+
+#include <cstddef>
+#include <string>
+#include <sys/un.h>
+
+using namespace std;
+
+// Протокол сервера: AF_UNIX SOCK_SEQPACKET, одно сообщение - одна команда,
+// строки разделены '\n', ответ - одно сообщение "OK ..." или "ERROR <текст>".
+//   FILE <coef>\n<input>\n<output>  - обработать файл, как обычный запуск
+//   SHM <coef>                      - с сообщением передаётся дескриптор memfd
+//                                     (SCM_RIGHTS) с PNM-файлом целиком; результат
+//                                     пишется в те же страницы, байты через сокет не идут
+//   STATS                           - счётчики: задания, байты, задержки, пропускная способность
+//   SHUTDOWN                        - остановить сервер; остальные открытые соединения
+//                                     закрываются после ответа на текущую команду
+// Только транспорт - клиенту не нужны ни PNMPicture, ни пул потоков
+namespace server_constants {
+    static const size_t maxMessageSize = 8192;
+}
+
+sockaddr_un socketAddress(const string& socketPath);
+
+// одно сообщение и, если пришёл, дескриптор из SCM_RIGHTS; false - соединение закрыто
+bool receiveMessage(int socket, string& message, int& fd);
+
+// fd, если он не -1, уходит вместе с сообщением через SCM_RIGHTS
+bool sendMessage(int socket, const string& message, int fd);
+
+// Клиентская сторона: отправляет request (и fd, если он не -1) и возвращает ответ
+string serverRequest(const string& socketPath, const string& request, int fd = -1);
+
+#endif //TESTPROJECT_SERVER_PROTOCOL_H
@@ -0,0 +1,277 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "shard.h"
+#include "block_io.h"
+#include "contrast.h"
+#include "image_buffer.h"
+#include "mapped_file.h"
+#include "pnm.h"
+#include "server_protocol.h"
+#include "time_monitor.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// куски кончаются на границе страницы выходного файла (с учётом заголовка) -
+// соседние рабочие не пишут в одну страницу
+static constexpr size_t shardAlignment = 4096;
+
+// состояние рабочего между JOB и BOUNDS: кусок лежит в памяти, второй раз не читается
+struct ShardState {
+    ImageBuffer data;
+    size_t outputOffset = 0;
+    int threadsCount = 1;
+    string output;
+};
+
+// table_fd - memfd с таблицей гистограмм, переходит во владение
+static string handleJob(ShardState& state, istringstream& stream, int table_fd) {
+    if (table_fd < 0) {
+        return "ERROR Job without histogram table";
+    }
+    MappedFile table;
+    table.openDescriptor(table_fd, true);
+
+    size_t inputOffset = 0;
+    size_t length = 0;
+    size_t row = 0;
+    string input;
+    stream >> inputOffset >> state.outputOffset >> length >> state.threadsCount >> row;
+    stream.ignore(1);
+    getline(stream, input);
+    getline(stream, state.output);
+    if (!stream || length == 0 || (row + 1) * 256 * sizeof(uint64_t) > table.size()) {
+        return "ERROR Malformed job";
+    }
+
+    BlockFile file;
+    file.openRead(input);
+    state.data.resize(length);
+    file.read(state.data.data(), length, inputOffset);
+
+    ImageView view{state.data.data(), length, 1, length, 1};
+    size_t elements[256];
+    contrastHistogram(view, elements, state.threadsCount);
+
+    uint64_t* counts = (uint64_t*)table.data() + row * 256;
+    for (int v = 0; v < 256; v++) {
+        counts[v] = elements[v];
+    }
+    return "OK";
+}
+
+static string handleBounds(ShardState& state, istringstream& stream) {
+    int min_v = 0;
+    int max_v = 0;
+    stream >> min_v >> max_v;
+    if (!stream || state.data.empty()) {
+        return "ERROR Bounds before job";
+    }
+
+    ImageView view{state.data.data(), state.data.size(), 1, state.data.size(), 1};
+    uchar table[256];
+    if (contrastBuildTable(uchar(min_v), uchar(max_v), table)) {
+        contrastApply(view, view, table, state.threadsCount);
+    }
+
+    BlockFile file;
+    file.openWrite(state.output);
+    file.write(state.data.data(), state.data.size(), state.outputOffset);
+    return "OK";
+}
+
+int runShardWorker(int socket) {
+    ShardState state;
+    string message;
+    int fd = -1;
+    while (receiveMessage(socket, message, fd)) {
+        istringstream stream(message);
+        string command;
+        stream >> command;
+
+        string reply;
+        try {
+            if (command == "JOB") {
+                int tableFd = fd;
+                fd = -1;
+                reply = handleJob(state, stream, tableFd);
+            } else if (command == "BOUNDS") {
+                reply = handleBounds(state, stream);
+            } else {
+                reply = "ERROR Unknown command " + command;
+            }
+        } catch (exception& e) {
+            reply = string("ERROR ") + e.what();
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (!sendMessage(socket, reply, -1)) {
+            break;
+        }
+    }
+    close(socket);
+    return 0;
+}
+
+// Локальные рабочие: по процессу на кусок, связь - пара сокетов.
+// Деструктор закрывает сокеты (рабочие видят конец и выходят) и дожидается процессов,
+// так что и после ошибки посередине зомби не остаются
+class LocalWorkers {
+public:
+    LocalWorkers(int count, const vector<string>& worker_args) {
+        for (int i = 0; i < count; i++) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) {
+                throw runtime_error("Error while trying to create shard socket");
+            }
+            // аргументы готовятся до fork: в дочернем процессе остальные потоки
+            // пропали вместе с их блокировками, до exec там нельзя даже malloc
+            const string fd = to_string(pair[1]);
+            vector<const char*> argv = {"contrast_shard", shard_constants::workerFlag.c_str(), fd.c_str()};
+            for (const string& arg : worker_args) {
+                argv.push_back(arg.c_str());
+            }
+            argv.push_back(nullptr);
+            pid_t pid = fork();
+            if (pid < 0) {
+                close(pair[0]);
+                close(pair[1]);
+                throw runtime_error("Error while trying to start shard worker");
+            }
+            if (pid == 0) {
+                fcntl(pair[1], F_SETFD, 0);
+                execv("/proc/self/exe", (char* const*)argv.data());
+                _exit(127);
+            }
+            close(pair[1]);
+            sockets.push_back(pair[0]);
+            pids.push_back(pid);
+        }
+    }
+
+    ~LocalWorkers() {
+        for (int socket : sockets) {
+            close(socket);
+        }
+        for (pid_t pid : pids) {
+            while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+            }
+        }
+    }
+
+    LocalWorkers(const LocalWorkers&) = delete;
+    LocalWorkers& operator=(const LocalWorkers&) = delete;
+
+    // запрос всем (с дескриптором fd, если он не -1) и ответы всех;
+    // ответ без OK - runtime_error с текстом рабочего
+    vector<string> broadcast(const vector<string>& requests, int fd = -1) {
+        for (size_t i = 0; i < sockets.size(); i++) {
+            if (!sendMessage(sockets[i], requests[i], fd)) {
+                throw runtime_error("Shard worker is not responding");
+            }
+        }
+        vector<string> replies(sockets.size());
+        for (size_t i = 0; i < sockets.size(); i++) {
+            int replyFd = -1;
+            bool isReceived = receiveMessage(sockets[i], replies[i], replyFd);
+            if (replyFd >= 0) {
+                close(replyFd);
+            }
+            if (!isReceived) {
+                throw runtime_error("Shard worker is not responding");
+            }
+            if (replies[i].compare(0, 2, "OK") != 0) {
+                throw runtime_error("Shard worker: " + replies[i].substr(min<size_t>(replies[i].size(), 6)));
+            }
+        }
+        return replies;
+    }
+
+private:
+    vector<int> sockets;
+    vector<pid_t> pids;
+};
+
+void shardedStretch(const string& input, const string& output, const float coeff, int shards_count,
+                    int threads_count, const vector<string>& worker_args) {
+    TimeMonitor::Phase shardPhase("shard");
+
+    PNMPicture picture;
+    const size_t headerSize = picture.probe(input);
+    if (picture.isAscii()) {
+        throw runtime_error("ASCII PNM is not supported in sharded mode");
+    }
+    if (picture.bytesPerSample != 1) {
+        throw runtime_error("16-bit samples are not supported in sharded mode");
+    }
+    const size_t dataSize = picture.data_size;
+
+    // выходной файл сразу нужного размера и с заголовком - рабочие пишут только тела
+    picture.mapOutput(output);
+    picture.closeMapped();
+    const size_t outputHeaderSize = size_t(filesystem::file_size(output)) - dataSize;
+
+    // конец куска округляется вверх в координатах файла, так что кусков не больше shards_count
+    const size_t shardLength = max((dataSize + shards_count - 1) / max(shards_count, 1), size_t(1));
+    vector<string> jobs;
+    for (size_t start = 0; start < dataSize;) {
+        size_t fileEnd = (outputHeaderSize + start + shardLength + shardAlignment - 1) / shardAlignment * shardAlignment;
+        size_t end = min(fileEnd - outputHeaderSize, dataSize);
+        jobs.push_back("JOB " + to_string(headerSize + start) + " " + to_string(outputHeaderSize + start) + " "
+                       + to_string(end - start) + " " + to_string(max(threads_count, 1)) + " " + to_string(jobs.size())
+                       + "\n" + input + "\n" + output);
+        start = end;
+    }
+
+    // гистограммы рабочих - строки общей таблицы uint64_t[jobs][256] в memfd:
+    // каждый пишет свою строку, координатор складывает их после ответов "OK"
+    int memory = memfd_create("contrast_shards", MFD_CLOEXEC);
+    if (memory < 0 || ftruncate(memory, off_t(jobs.size() * 256 * sizeof(uint64_t))) != 0) {
+        if (memory >= 0) {
+            close(memory);
+        }
+        throw runtime_error("Error while trying to create shard histogram table");
+    }
+    // отображение владеет дескриптором и держит его открытым - его же получают рабочие
+    MappedFile table;
+    table.openDescriptor(memory, true);
+
+    LocalWorkers workers(int(jobs.size()), worker_args);
+
+    size_t elements[256] = {0};
+    {
+        TimeMonitor::Phase phase("histogram");
+        workers.broadcast(jobs, memory);
+        const uint64_t* counts = (const uint64_t*)table.data();
+        for (size_t row = 0; row < jobs.size(); row++) {
+            for (int v = 0; v < 256; v++) {
+                elements[v] += counts[row * 256 + v];
+            }
+        }
+    }
+
+    uchar min_v = 255;
+    uchar max_v = 0;
+    {
+        TimeMonitor::Phase phase("minmax");
+        contrastMinMax(elements, size_t(dataSize * coeff), min_v, max_v);
+    }
+
+    TimeMonitor::Phase phase("remap");
+    const string bounds = "BOUNDS " + to_string(min_v) + " " + to_string(max_v);
+    workers.broadcast(vector<string>(jobs.size(), bounds));
+}
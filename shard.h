@@ -0,0 +1,41 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_SHARD_H
+#define TESTPROJECT_SHARD_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Растяжение одного большого P5/P6 несколькими процессами.
+// Координатор делит тело на куски по границам страниц, создаёт выходной файл
+// с заголовком и раздаёт куски рабочим. Рабочий читает свой кусок позиционным
+// чтением (block_io.h) и пишет его гистограмму в свою строку общей таблицы;
+// координатор складывает строки, считает границы и рассылает их, рабочие делают
+// remap и пишут кусок в выходной файл по тому же смещению.
+// Протокол, как у server_protocol.h: AF_UNIX SOCK_SEQPACKET, одно сообщение - одна
+// команда, ответ - "OK" или "ERROR <текст>":
+//   JOB <input_offset> <output_offset> <length> <threads> <row>\n<input>\n<output>
+//                         - с сообщением (SCM_RIGHTS) приходит memfd с таблицей
+//                           uint64_t[рабочие][256]; прочитать кусок и записать его
+//                           гистограмму в строку row
+//   BOUNDS <min_v> <max_v> - remap по границам (растягивать нечего - кусок как есть)
+//                            и запись, ответ "OK"
+// Из-за общей памяти рабочие - только локальные процессы (fork + exec этой же
+// программы с --shard-worker и настройками ввода-вывода, памяти и закрепления координатора)
+namespace shard_constants {
+    static const string workerFlag = "--shard-worker";
+}
+
+// shards_count процессов, у каждого threads_count потоков; worker_args дописываются
+// в командную строку рабочих. Ошибки - runtime_error
+void shardedStretch(const string& input, const string& output, const float coeff, int shards_count,
+                    int threads_count, const vector<string>& worker_args);
+
+// цикл рабочего на подключённом сокете: до закрытия сокета координатором
+int runShardWorker(int socket);
+
+#endif //TESTPROJECT_SHARD_H
@@ -0,0 +1,297 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "thread_pool.h"
+#include "time_monitor.h"
+#include <algorithm>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+// вложенный parallelFor из потока пула выполняется последовательно, иначе пул
+// ждал бы сам себя
+static thread_local bool isInsidePool = false;
+
+static mutex pinningLock;
+static string pinningKind = "none";
+
+bool ThreadPool::setPinning(const string& pin_kind) {
+    if (pin_kind != "none" && pin_kind != "cores" && pin_kind != "nodes") {
+        return false;
+    }
+    lock_guard<mutex> guard(pinningLock);
+    pinningKind = pin_kind;
+    return true;
+}
+
+// процессоры, доступные процессу при запуске - до того, как пул закрепил главный поток
+static const vector<int>& allowedCpus() {
+    static const vector<int> cpus = []() {
+        vector<int> result;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) {
+                    result.push_back(cpu);
+                }
+            }
+        }
+        return result;
+    }();
+    return cpus;
+}
+
+// список вида "0-3,8-11" из /sys/devices/system/node/nodeN/cpulist
+static vector<int> readCpuList(FILE* file) {
+    vector<int> cpus;
+    int first;
+    while (fscanf(file, "%d", &first) == 1) {
+        int last = first;
+        int separator = fgetc(file);
+        if (separator == '-') {
+            if (fscanf(file, "%d", &last) != 1) {
+                break;
+            }
+            separator = fgetc(file);
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+        if (separator != ',') {
+            break;
+        }
+    }
+    return cpus;
+}
+
+// доступные процессоры по NUMA-узлам; без sysfs - один узел со всеми
+static vector<vector<int>> nodeCpus() {
+    const vector<int>& allowed = allowedCpus();
+    vector<vector<int>> nodes;
+    for (int node = 0;; node++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* file = fopen(path, "r");
+        if (file == nullptr) {
+            break;
+        }
+        vector<int> cpus;
+        for (int cpu : readCpuList(file)) {
+            if (find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+        fclose(file);
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+    if (nodes.empty()) {
+        nodes.push_back(allowed);
+    }
+    return nodes;
+}
+
+static void pinCurrentThread(const vector<int>& cpus) noexcept {
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+ThreadPool::ThreadPool(int threadsCount) : threadsCount(max(threadsCount, 1)) {
+    string pin_kind;
+    {
+        lock_guard<mutex> guard(pinningLock);
+        pin_kind = pinningKind;
+    }
+    const vector<int>& allowed = allowedCpus();
+    if (pin_kind == "cores" && !allowed.empty()) {
+        for (int thread_index = 0; thread_index < this->threadsCount; thread_index++) {
+            threadCpus.push_back({allowed[thread_index % allowed.size()]});
+        }
+    } else if (pin_kind == "nodes") {
+        vector<vector<int>> nodes = nodeCpus();
+        for (int thread_index = 0; thread_index < this->threadsCount; thread_index++) {
+            threadCpus.push_back(nodes[size_t(thread_index) * nodes.size() / this->threadsCount]);
+        }
+    }
+    if (!threadCpus.empty()) {
+        pinCurrentThread(threadCpus[0]);
+    }
+
+    for (int thread_index = 1; thread_index < this->threadsCount; thread_index++) {
+        workers.emplace_back([this, thread_index]() { workerLoop(thread_index); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        isStopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop(int threadIndex) {
+    isInsidePool = true;
+    if (!threadCpus.empty()) {
+        pinCurrentThread(threadCpus[threadIndex]);
+    }
+    size_t seenGeneration = 0;
+    while (true) {
+        const function<void(int)>* task;
+        {
+            unique_lock<mutex> guard(lock);
+            wakeUp.wait(guard, [this, seenGeneration]() { return isStopping || generation != seenGeneration; });
+            if (isStopping) {
+                return;
+            }
+            seenGeneration = generation;
+            // задача на меньшее число потоков - этот её пропускает
+            if (threadIndex >= taskThreadsCount) {
+                continue;
+            }
+            task = currentTask;
+        }
+
+        (*task)(threadIndex);
+
+        lock_guard<mutex> guard(lock);
+        if (--activeWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run(const function<void(int)>& task, int threads_count) {
+    const int usedCount = clamp(threads_count, 1, threadsCount);
+    if (isInsidePool || usedCount == 1) {
+        for (int thread_index = 0; thread_index < usedCount; thread_index++) {
+            task(thread_index);
+        }
+        return;
+    }
+
+    lock_guard<mutex> runGuard(runLock);
+
+    // время каждого потока пишется в текущую фазу профилировщика вызывающего потока
+    const string phasePath = TimeMonitor::currentPhasePath();
+    const function<void(int)> timedTask = [&task, &phasePath](int thread_index) {
+        TimeMonitor::ThreadPhase threadPhase(phasePath, thread_index);
+        task(thread_index);
+    };
+
+    {
+        lock_guard<mutex> guard(lock);
+        currentTask = &timedTask;
+        taskThreadsCount = usedCount;
+        activeWorkers = usedCount - 1;
+        generation++;
+    }
+    wakeUp.notify_all();
+
+    isInsidePool = true;
+    timedTask(0);
+    isInsidePool = false;
+
+    unique_lock<mutex> guard(lock);
+    finished.wait(guard, [this]() { return activeWorkers == 0; });
+    currentTask = nullptr;
+}
+
+bool ThreadPool::isKnownSchedule(const string& schedule_kind) noexcept {
+    return schedule_kind == "static" || schedule_kind == "dynamic" || schedule_kind == "guided";
+}
+
+bool ThreadPool::parallelFor(size_t count, const string& schedule_kind, size_t chunk_size, const RangeBody& body,
+                             int threads_count) {
+    const int usedCount = clamp(threads_count, 1, threadsCount);
+    const size_t threads = usedCount;
+
+    if (schedule_kind == "static") {
+        if (chunk_size == 0) {
+            run([&](int thread_index) {
+                size_t start = count * thread_index / threads;
+                size_t end = count * (thread_index + 1) / threads;
+                if (start < end) {
+                    body(start, end, thread_index);
+                }
+            }, usedCount);
+        } else {
+            run([&](int thread_index) {
+                for (size_t start = thread_index * chunk_size; start < count; start += threads * chunk_size) {
+                    body(start, min(start + chunk_size, count), thread_index);
+                }
+            }, usedCount);
+        }
+        return true;
+    }
+
+    if (schedule_kind == "dynamic") {
+        const size_t dynamic_chunk_size = chunk_size == 0 ? 1 : chunk_size;
+        atomic<size_t> nextStart = 0;
+        run([&](int thread_index) {
+            size_t start;
+            while ((start = nextStart.fetch_add(dynamic_chunk_size, memory_order_relaxed)) < count) {
+                body(start, min(start + dynamic_chunk_size, count), thread_index);
+            }
+        }, usedCount);
+        return true;
+    }
+
+    if (schedule_kind == "guided") {
+        // как в OpenMP: кусок пропорционален оставшейся работе, но не меньше chunk_size
+        const size_t min_chunk_size = chunk_size == 0 ? 1 : chunk_size;
+        atomic<size_t> nextStart = 0;
+        run([&](int thread_index) {
+            size_t start = nextStart.load(memory_order_relaxed);
+            while (start < count) {
+                size_t length = max(min_chunk_size, (count - start) / (2 * threads));
+                size_t end = min(start + length, count);
+                if (nextStart.compare_exchange_weak(start, end, memory_order_relaxed)) {
+                    body(start, end, thread_index);
+                    start = nextStart.load(memory_order_relaxed);
+                }
+            }
+        }, usedCount);
+        return true;
+    }
+
+    return false;
+}
+
+static mutex sharedLock;
+// общий пул не удаляется никогда: ссылка на него может быть у любого потока,
+// а потоки пула при выходе из процесса просто завершаются вместе с ним
+static ThreadPool* sharedPool = nullptr;
+
+static ThreadPool& sharedPoolLocked(int threadsCount) {
+    if (sharedPool == nullptr) {
+        sharedPool = new ThreadPool(threadsCount);
+    }
+    return *sharedPool;
+}
+
+ThreadTeam ThreadPool::shared(int threadsCount) {
+    lock_guard<mutex> guard(sharedLock);
+    ThreadPool& pool = sharedPoolLocked(max(int(thread::hardware_concurrency()), 1));
+    return ThreadTeam(pool, clamp(threadsCount, 1, pool.size()));
+}
+
+bool ThreadPool::configureShared(int threadsCount) {
+    lock_guard<mutex> guard(sharedLock);
+    return sharedPoolLocked(max(threadsCount, 1)).size() == max(threadsCount, 1);
+}
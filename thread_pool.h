@@ -0,0 +1,109 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_THREAD_POOL_H
+#define TESTPROJECT_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class ThreadTeam;
+
+// Постоянный пул потоков для std::thread-бэкенда: потоки создаются один раз
+// и переиспользуются между вызовами и изображениями. Вызывающий поток
+// тоже работает как поток с индексом 0.
+// Куски раздаются без блокировок - через atomic-счётчик.
+// Каждый вызов берёт только первые threads_count потоков пула; вызовы из разных
+// потоков не пересекаются - пул выполняет одну задачу за раз, остальные ждут
+class ThreadPool {
+public:
+    // тело цикла: [begin, end) и индекс потока в [0, threads_count)
+    typedef function<void(size_t, size_t, int)> RangeBody;
+
+    explicit ThreadPool(int threadsCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const noexcept { return threadsCount; }
+
+    // раздаёт [0, count) по расписанию static / dynamic / guided на threads_count
+    // потоках (не больше size()) и ждёт завершения.
+    // chunk_size = 0: static - по одному сплошному куску на поток, dynamic - по 1,
+    // guided - минимальный кусок 1. Возвращает false для неизвестного расписания
+    bool parallelFor(size_t count, const string& schedule_kind, size_t chunk_size, const RangeBody& body,
+                     int threads_count);
+
+    // static / dynamic / guided - то, что понимает parallelFor
+    static bool isKnownSchedule(const string& schedule_kind) noexcept;
+
+    // выполняет task(threadIndex) по разу на каждом из threads_count потоков
+    void run(const function<void(int)>& task, int threads_count);
+
+    // Общий пул процесса. Создаётся один раз и живёт до выхода - ссылку на него
+    // можно держать сколько угодно; threadsCount только ограничивает, сколько
+    // его потоков возьмёт вызов (не больше размера пула)
+    static ThreadTeam shared(int threadsCount);
+    // размер общего пула - до первого shared; по умолчанию число ядер.
+    // false - пул уже создан другого размера
+    static bool configureShared(int threadsCount);
+
+    // закрепление потоков пула за процессорами: "none" (по умолчанию),
+    // "cores" - поток i на i-м доступном ядре, "nodes" - потоки сплошными группами,
+    // как static-куски, на ядрах своего NUMA-узла. Вызывающий поток закрепляется
+    // как поток 0. Действует на пулы, созданные после вызова; false для неизвестного режима
+    static bool setPinning(const string& pin_kind);
+
+private:
+    void workerLoop(int threadIndex);
+
+    const int threadsCount;
+    vector<thread> workers;
+    // процессоры каждого потока; пусто - без закрепления
+    vector<vector<int>> threadCpus;
+
+    // одновременно пул выполняет только одну задачу
+    mutex runLock;
+    mutex lock;
+    condition_variable wakeUp;
+    condition_variable finished;
+    const function<void(int)>* currentTask = nullptr;
+    // сколько первых потоков выполняют currentTask
+    int taskThreadsCount = 0;
+    size_t generation = 0;
+    int activeWorkers = 0;
+    bool isStopping = false;
+};
+
+// Первые threadsCount потоков общего пула - то, что получает вызывающий код.
+// Лёгкий объект: копируется по значению, сам потоков не владеет
+class ThreadTeam {
+public:
+    ThreadTeam(ThreadPool& pool, int threadsCount) : pool(&pool), threadsCount(threadsCount) {}
+
+    int size() const noexcept { return threadsCount; }
+
+    bool parallelFor(size_t count, const string& schedule_kind, size_t chunk_size,
+                     const ThreadPool::RangeBody& body) const {
+        return pool->parallelFor(count, schedule_kind, chunk_size, body, threadsCount);
+    }
+
+    void run(const function<void(int)>& task) const {
+        pool->run(task, threadsCount);
+    }
+
+private:
+    ThreadPool* pool;
+    int threadsCount;
+};
+
+#endif //TESTPROJECT_THREAD_POOL_H
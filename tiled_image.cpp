@@ -0,0 +1,276 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#include "tiled_image.h"
+#include "histogram.h"
+#include "thread_pool.h"
+#include "time_monitor.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+using namespace std;
+
+static const char tiledMagic[4] = {'C', 'T', 'L', '1'};
+static constexpr uint32_t tiledVersion = 1;
+static constexpr size_t pageSize = 4096;
+// гистограмма тайла в uint32_t: тайл не больше 4096 x 4096 x 3 байт
+static constexpr size_t maxTileSize = 4096;
+
+static size_t alignToPage(size_t value) {
+    return (value + pageSize - 1) / pageSize * pageSize;
+}
+
+// тайлы разного размера (крайние) и разной стоимости - раздаём по одному
+template <class Body>
+static void forEachTile(size_t count, const int threads_count, Body body) {
+    ThreadPool::shared(threads_count).parallelFor(count, "dynamic", 1, [&body](size_t tile, size_t, int) {
+        body(tile);
+    });
+}
+
+void TiledImage::open(const string& fileName) {
+    close();
+    mapping.openRead(fileName, false);
+
+    const TiledHeader& h = header();
+    bool isValid = mapping.size() >= sizeof(TiledHeader)
+        && memcmp(h.magic, tiledMagic, sizeof(tiledMagic)) == 0
+        && h.version == tiledVersion
+        && (h.channels == 1 || h.channels == 3)
+        && h.width > 0 && h.height > 0
+        && h.tileWidth > 0 && h.tileWidth <= maxTileSize
+        && h.tileHeight > 0 && h.tileHeight <= maxTileSize
+        && h.tilesX == (h.width + h.tileWidth - 1) / h.tileWidth
+        && h.tilesY == (h.height + h.tileHeight - 1) / h.tileHeight
+        && h.dataOffset % pageSize == 0 && h.tileStride % pageSize == 0
+        && h.dataOffset >= sizeof(TiledHeader) + tilesCount() * sizeof(TileIndex)
+        && h.tileStride >= uint64_t(h.tileWidth) * h.tileHeight * h.channels
+        && mapping.size() >= h.dataOffset + tilesCount() * h.tileStride;
+    if (!isValid) {
+        close();
+        throw runtime_error("Invalid tiled image file");
+    }
+    // тайлы читаются вразнобой разными потоками - опережающее чтение только мешает
+    madvise(mapping.data(), mapping.size(), MADV_NORMAL);
+}
+
+void TiledImage::create(const string& fileName, size_t width, size_t height, int channels,
+                        size_t tile_width, size_t tile_height) {
+    close();
+    if (width == 0 || height == 0 || (channels != 1 && channels != 3)
+        || width > UINT32_MAX || height > UINT32_MAX) {
+        throw runtime_error("Unsupported image for tiled container");
+    }
+    // у маленького изображения тайл не больше его самого
+    const size_t tileWidth = clamp<size_t>(tile_width, 1, min(width, maxTileSize));
+    const size_t tileHeight = clamp<size_t>(tile_height, 1, min(height, maxTileSize));
+
+    const size_t tilesX = (width + tileWidth - 1) / tileWidth;
+    const size_t tilesY = (height + tileHeight - 1) / tileHeight;
+    const size_t dataOffset = alignToPage(sizeof(TiledHeader) + tilesX * tilesY * sizeof(TileIndex));
+    const size_t tileStride = alignToPage(tileWidth * tileHeight * channels);
+
+    // ftruncate даёт нули - и индекс, и хвосты крайних тайлов уже чистые
+    mapping.create(fileName, dataOffset + tilesX * tilesY * tileStride);
+
+    TiledHeader& h = header();
+    memcpy(h.magic, tiledMagic, sizeof(tiledMagic));
+    h.version = tiledVersion;
+    h.width = uint32_t(width);
+    h.height = uint32_t(height);
+    h.channels = uint32_t(channels);
+    h.tileWidth = uint32_t(tileWidth);
+    h.tileHeight = uint32_t(tileHeight);
+    h.tilesX = uint32_t(tilesX);
+    h.tilesY = uint32_t(tilesY);
+    h.dataOffset = dataOffset;
+    h.tileStride = tileStride;
+}
+
+void TiledImage::close() noexcept {
+    mapping.close();
+}
+
+TileIndex& TiledImage::tileIndex(size_t tile) const noexcept {
+    return ((TileIndex*)(mapping.data() + sizeof(TiledHeader)))[tile];
+}
+
+ImageView TiledImage::tileView(size_t tile) const noexcept {
+    const TiledHeader& h = header();
+    const size_t x0 = (tile % h.tilesX) * h.tileWidth;
+    const size_t y0 = (tile / h.tilesX) * h.tileHeight;
+
+    ImageView view;
+    view.data = mapping.data() + h.dataOffset + tile * h.tileStride;
+    view.width = min<size_t>(h.tileWidth, h.width - x0);
+    view.height = min<size_t>(h.tileHeight, h.height - y0);
+    view.stride = size_t(h.tileWidth) * h.channels;
+    view.channels = int(h.channels);
+    return view;
+}
+
+void TiledImage::regionHistogram(const TileRegion& region, size_t* elements) const {
+    const TiledHeader& h = header();
+    if (region.width == 0) {
+        copy(h.elements, h.elements + 256, elements);
+        return;
+    }
+    if (region.height == 0 || region.x >= h.width || region.y >= h.height) {
+        throw runtime_error("Region is outside of the image");
+    }
+
+    const size_t firstX = region.x / h.tileWidth;
+    const size_t lastX = (min<size_t>(region.x + region.width, h.width) - 1) / h.tileWidth;
+    const size_t firstY = region.y / h.tileHeight;
+    const size_t lastY = (min<size_t>(region.y + region.height, h.height) - 1) / h.tileHeight;
+
+    fill(elements, elements + 256, 0);
+    for (size_t tileY = firstY; tileY <= lastY; tileY++) {
+        for (size_t tileX = firstX; tileX <= lastX; tileX++) {
+            const TileIndex& index = tileIndex(tileY * h.tilesX + tileX);
+            for (int v = 0; v < 256; v++) {
+                elements[v] += index.elements[v];
+            }
+        }
+    }
+}
+
+static void fillTileIndex(TileIndex& index, const size_t* elements) noexcept {
+    index.minValue = 255;
+    index.maxValue = 0;
+    for (int v = 0; v < 256; v++) {
+        index.elements[v] = uint32_t(elements[v]);
+        if (elements[v] != 0) {
+            index.minValue = min<uint8_t>(index.minValue, uint8_t(v));
+            index.maxValue = uint8_t(v);
+        }
+    }
+}
+
+// общая гистограмма заголовка - сумма индексов, один поток: тайлов немного
+static void sumTileIndexes(TiledImage& image) noexcept {
+    TiledHeader& h = image.header();
+    fill(h.elements, h.elements + 256, 0);
+    for (size_t tile = 0; tile < image.tilesCount(); tile++) {
+        const TileIndex& index = image.tileIndex(tile);
+        for (int v = 0; v < 256; v++) {
+            h.elements[v] += index.elements[v];
+        }
+    }
+}
+
+void tiledFromPicture(const PNMPicture& picture, const string& fileName, size_t tile_size, const int threads_count) {
+    if (picture.bytesPerSample != 1) {
+        throw runtime_error("16-bit samples are not supported in tiled container");
+    }
+    TimeMonitor::Phase phase("tile");
+
+    TiledImage image;
+    image.create(fileName, picture.width, picture.height, picture.channelsCount, tile_size, tile_size);
+    const size_t rowBytes = size_t(picture.width) * picture.channelsCount;
+    const uchar* s = picture.data.data();
+
+    forEachTile(image.tilesCount(), threads_count, [&image, s, rowBytes](size_t tile) {
+        const TiledHeader& h = image.header();
+        const ImageView view = image.tileView(tile);
+        const size_t x0 = (tile % h.tilesX) * h.tileWidth;
+        const size_t y0 = (tile / h.tilesX) * h.tileHeight;
+        const uchar* source = s + y0 * rowBytes + x0 * view.channels;
+        for (size_t row = 0; row < view.height; row++) {
+            memcpy(view.data + row * view.stride, source + row * rowBytes, view.rowBytes());
+        }
+
+        size_t elements[256] = {0};
+        histogramAccumulateRows(view.data, view.rowBytes(), view.height, view.stride, elements);
+        fillTileIndex(image.tileIndex(tile), elements);
+    });
+
+    sumTileIndexes(image);
+}
+
+void tiledToPicture(const TiledImage& image, PNMPicture& picture, const int threads_count, const uchar* table) {
+    TimeMonitor::Phase phase("untile");
+
+    const TiledHeader& h = image.header();
+    picture.format = h.channels == 3 ? 6 : 5;
+    picture.width = int(h.width);
+    picture.height = int(h.height);
+    picture.colors = 255;
+    picture.channelsCount = short(h.channels);
+    picture.bytesPerSample = 1;
+    picture.data_size = size_t(h.width) * h.height * h.channels;
+    picture.data.resize(picture.data_size);
+
+    const size_t rowBytes = size_t(h.width) * h.channels;
+    uchar* d = picture.data.data();
+    forEachTile(image.tilesCount(), threads_count, [&image, &h, d, rowBytes, table](size_t tile) {
+        const ImageView view = image.tileView(tile);
+        const size_t x0 = (tile % h.tilesX) * h.tileWidth;
+        const size_t y0 = (tile / h.tilesX) * h.tileHeight;
+
+        ImageView target = view;
+        target.data = d + y0 * rowBytes + x0 * view.channels;
+        target.stride = rowBytes;
+        if (table != nullptr) {
+            contrastApply(view, target, table, 1);
+        } else {
+            for (size_t row = 0; row < view.height; row++) {
+                memcpy(target.data + row * target.stride, view.data + row * view.stride, view.rowBytes());
+            }
+        }
+    });
+}
+
+void tiledBuildTable(const TiledImage& image, const float coeff, const TileRegion& region, uchar* table) {
+    size_t elements[256];
+    image.regionHistogram(region, elements);
+    size_t samplesCount = 0;
+    for (size_t count : elements) {
+        samplesCount += count;
+    }
+
+    uchar min_v = 255;
+    uchar max_v = 0;
+    contrastMinMax(elements, size_t(samplesCount * coeff), min_v, max_v);
+    if (!contrastBuildTable(min_v, max_v, table)) {
+        for (int v = 0; v < 256; v++) {
+            table[v] = uchar(v);
+        }
+    }
+}
+
+void tiledStretch(const string& input, const string& output, const float coeff, const TileRegion& region,
+                  const int threads_count) {
+    TiledImage source;
+    source.open(input);
+    const TiledHeader& h = source.header();
+
+    uchar table[256];
+    {
+        TimeMonitor::Phase phase("minmax");
+        tiledBuildTable(source, coeff, region, table);
+    }
+
+    TiledImage target;
+    target.create(output, h.width, h.height, int(h.channels), h.tileWidth, h.tileHeight);
+
+    TimeMonitor::Phase phase("remap");
+    forEachTile(source.tilesCount(), threads_count, [&source, &target, &table](size_t tile) {
+        contrastApply(source.tileView(tile), target.tileView(tile), table, 1);
+
+        // таблица монотонна: гистограмма тайла просто переносится по ней,
+        // min/max - образы старых границ
+        const TileIndex& from = source.tileIndex(tile);
+        TileIndex& to = target.tileIndex(tile);
+        for (int v = 0; v < 256; v++) {
+            to.elements[table[v]] += from.elements[v];
+        }
+        to.minValue = table[from.minValue];
+        to.maxValue = table[from.maxValue];
+    });
+
+    sumTileIndexes(target);
+}
@@ -0,0 +1,96 @@
+//
+// Created by Igor Kluzhev on 17.10.2026.
+//
+
+#ifndef TESTPROJECT_TILED_IMAGE_H
+#define TESTPROJECT_TILED_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "contrast.h"
+#include "mapped_file.h"
+#include "pnm.h"
+
+using namespace std;
+
+// Тайловый контейнер (.ctl) для мастер-изображений, которые растягиваются много раз
+// с разными coeff. Изображение (8 бит, 1 или 3 канала) хранится тайлами
+// tileWidth x tileHeight, у каждого тайла в индексе - гистограмма его байтов и min/max,
+// в заголовке - гистограмма всего изображения. Границы для любого coeff (и для
+// прямоугольника с точностью до тайла) считаются по заголовку и индексу, тела тайлов
+// при этом не читаются. Тела начинаются с границы страницы и занимают целое число
+// страниц, так что remap идёт по тайлам параллельно без общих страниц и линий кэша.
+// Числа - в порядке байтов машины (little-endian на x86 и ARM)
+struct TiledHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t tileWidth;
+    uint32_t tileHeight;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    uint32_t reserved;
+    // смещение первого тайла и шаг между тайлами, оба кратны 4096
+    uint64_t dataOffset;
+    uint64_t tileStride;
+    uint64_t elements[256];
+};
+
+// запись индекса: тайлы идут по строкам, крайние тайлы обрезаны по краю
+// изображения, в гистограмме только байты внутри изображения
+struct TileIndex {
+    uint32_t elements[256];
+    uint8_t minValue;
+    uint8_t maxValue;
+    uint8_t reserved[6];
+};
+
+// прямоугольник в пикселях; width = 0 - всё изображение
+struct TileRegion {
+    size_t x = 0;
+    size_t y = 0;
+    size_t width = 0;
+    size_t height = 0;
+};
+
+class TiledImage {
+public:
+    // отображает контейнер и проверяет заголовок; runtime_error на чужой или битый файл
+    void open(const string& fileName);
+    // новый контейнер с пустым индексом и нулевыми тайлами
+    void create(const string& fileName, size_t width, size_t height, int channels, size_t tile_width, size_t tile_height);
+    void close() noexcept;
+
+    const TiledHeader& header() const noexcept { return *(const TiledHeader*)mapping.data(); }
+    TiledHeader& header() noexcept { return *(TiledHeader*)mapping.data(); }
+    size_t tilesCount() const noexcept { return size_t(header().tilesX) * header().tilesY; }
+    TileIndex& tileIndex(size_t tile) const noexcept;
+    // тайл как вид: крайние обрезаны по изображению, stride - полная ширина тайла
+    ImageView tileView(size_t tile) const noexcept;
+
+    // гистограмма тайлов, пересекающих region, в elements[0..256) - только по индексу
+    void regionHistogram(const TileRegion& region, size_t* elements) const;
+
+private:
+    MappedFile mapping;
+};
+
+// P5/P6 из picture (после read) в контейнер; тайлы tile_size x tile_size
+// заполняются и считаются параллельно
+void tiledFromPicture(const PNMPicture& picture, const string& fileName, size_t tile_size, const int threads_count);
+// обратно в picture (P5/P6 в data); table != nullptr - тайлы по пути проходят через неё
+void tiledToPicture(const TiledImage& image, PNMPicture& picture, const int threads_count, const uchar* table = nullptr);
+
+// таблица растяжения по заголовку и индексу, как в modify: гистограмма region,
+// тёмная граница отступает на coeff, светлая - последняя непустая корзина (determineMinMax),
+// contrastBuildTable (нечего растягивать - тождественная)
+void tiledBuildTable(const TiledImage& image, const float coeff, const TileRegion& region, uchar* table);
+// растянутая копия контейнера: тайлы remap параллельно, индекс пересчитывается
+// по таблице без нового прохода гистограммы
+void tiledStretch(const string& input, const string& output, const float coeff, const TileRegion& region,
+                  const int threads_count);
+
+#endif //TESTPROJECT_TILED_IMAGE_H
@@ -4,6 +4,9 @@
 
 #include "time_monitor.h"
 #include <chrono>
+#include <atomic>
+#include <map>
+#include <mutex>
 
 using namespace std;
 
@@ -23,8 +26,135 @@ double TimeMonitor::stop() {
     if (isActive) {
         isActive = false;
         elapsedTime = double(chrono::duration_cast<chrono::microseconds>(end_time - start_time).count()) / 1000;
-        printf("Time (%i threads): %lg\n", threadsNum, elapsedTime);
+        if (autoPrintOnStop) {
+            printf("Time (%i threads): %lg\n", threadsNum, elapsedTime);
+        }
         return elapsedTime;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+struct PhaseStats {
+    size_t calls = 0;
+    double totalTime = 0;
+    map<int, double> threadTimes;
+};
+
+static atomic<bool> profilingEnabled = false;
+static mutex profileLock;
+// упорядочено по пути - вложенные фазы идут сразу за родительской
+static map<string, PhaseStats> phases;
+static thread_local vector<const char*> phaseStack;
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+TimeMonitor::Phase::Phase(const char* name) {
+    isActive = profilingEnabled.load(memory_order_relaxed);
+    if (isActive) {
+        phaseStack.push_back(name);
+        start_time = chrono::steady_clock::now();
+    }
+}
+
+TimeMonitor::Phase::~Phase() {
+    if (!isActive) {
+        return;
+    }
+    double elapsed = elapsedMs(start_time);
+    string path = currentPhasePath();
+    phaseStack.pop_back();
+
+    lock_guard<mutex> guard(profileLock);
+    PhaseStats& stats = phases[path];
+    stats.calls++;
+    stats.totalTime += elapsed;
+}
+
+TimeMonitor::ThreadPhase::ThreadPhase(const string& path, int threadIndex) : threadIndex(threadIndex) {
+    this->path = profilingEnabled.load(memory_order_relaxed) ? &path : nullptr;
+    if (this->path != nullptr) {
+        start_time = chrono::steady_clock::now();
+    }
+}
+
+TimeMonitor::ThreadPhase::~ThreadPhase() {
+    if (path == nullptr) {
+        return;
+    }
+    double elapsed = elapsedMs(start_time);
+
+    lock_guard<mutex> guard(profileLock);
+    phases[*path].threadTimes[threadIndex] += elapsed;
+}
+
+void TimeMonitor::enableProfiling(bool isEnabled) {
+    profilingEnabled = isEnabled;
+}
+
+bool TimeMonitor::isProfiling() {
+    return profilingEnabled.load(memory_order_relaxed);
+}
+
+void TimeMonitor::resetProfile() {
+    lock_guard<mutex> guard(profileLock);
+    phases.clear();
+}
+
+string TimeMonitor::currentPhasePath() {
+    string path;
+    for (const char* name : phaseStack) {
+        if (!path.empty()) {
+            path += "/";
+        }
+        path += name;
+    }
+    return path;
+}
+
+struct ThreadBalance {
+    size_t threads = 0;
+    double maxTime = 0;
+    double meanTime = 0;
+    double imbalance = 0;
+};
+
+static ThreadBalance threadBalance(const PhaseStats& stats) {
+    ThreadBalance balance;
+    balance.threads = stats.threadTimes.size();
+    if (balance.threads == 0) {
+        return balance;
+    }
+    for (const auto& [thread_index, time] : stats.threadTimes) {
+        balance.maxTime = max(balance.maxTime, time);
+        balance.meanTime += time / double(balance.threads);
+    }
+    balance.imbalance = balance.meanTime > 0 ? balance.maxTime / balance.meanTime : 0;
+    return balance;
+}
+
+void TimeMonitor::writeProfileJson(FILE* out) {
+    lock_guard<mutex> guard(profileLock);
+    fprintf(out, "{\"phases\": [");
+    bool isFirst = true;
+    for (const auto& [path, stats] : phases) {
+        ThreadBalance balance = threadBalance(stats);
+        fprintf(out, "%s\n  {\"phase\": \"%s\", \"calls\": %zu, \"total_ms\": %lg, \"threads\": %zu, "
+                     "\"thread_max_ms\": %lg, \"thread_mean_ms\": %lg, \"imbalance\": %lg}",
+                isFirst ? "" : ",", path.c_str(), stats.calls, stats.totalTime, balance.threads,
+                balance.maxTime, balance.meanTime, balance.imbalance);
+        isFirst = false;
+    }
+    fprintf(out, "\n]}\n");
+}
+
+void TimeMonitor::writeProfileCsv(FILE* out) {
+    lock_guard<mutex> guard(profileLock);
+    fprintf(out, "PHASE;CALLS;TOTAL_MS;THREADS;THREAD_MAX_MS;THREAD_MEAN_MS;IMBALANCE\n");
+    for (const auto& [path, stats] : phases) {
+        ThreadBalance balance = threadBalance(stats);
+        fprintf(out, "%s;%zu;%lg;%zu;%lg;%lg;%lg\n", path.c_str(), stats.calls, stats.totalTime,
+                balance.threads, balance.maxTime, balance.meanTime, balance.imbalance);
+    }
+}
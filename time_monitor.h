@@ -7,6 +7,8 @@
 
 #include <string>
 #include <chrono>
+#include <cstdio>
+#include <vector>
 
 using namespace std;
 
@@ -17,6 +19,48 @@ public:
     void start();
     double stop();
 
+    // Профилировщик по фазам. Пока он выключен, Phase/ThreadPhase ничего не делают,
+    // кроме одной проверки флага. Фазы вкладываются: путь фазы - это имена всех
+    // открытых в этом потоке Phase через "/", например "modify/histogram"
+    class Phase {
+    public:
+        explicit Phase(const char* name);
+        ~Phase();
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+    private:
+        chrono::steady_clock::time_point start_time;
+        bool isActive;
+    };
+
+    // время одного потока внутри параллельной области: путь берётся у
+    // вызывающего потока (currentPhasePath) до входа в область
+    class ThreadPhase {
+    public:
+        ThreadPhase(const string& path, int threadIndex);
+        ~ThreadPhase();
+
+        ThreadPhase(const ThreadPhase&) = delete;
+        ThreadPhase& operator=(const ThreadPhase&) = delete;
+
+    private:
+        chrono::steady_clock::time_point start_time;
+        const string* path;
+        int threadIndex;
+    };
+
+    static void enableProfiling(bool isEnabled);
+    static bool isProfiling();
+    static void resetProfile();
+    static string currentPhasePath();
+
+    // для каждой фазы: число вызовов, суммарное время, и для фаз с потоками -
+    // max/mean времени потока и их отношение (1 - идеальный баланс)
+    static void writeProfileJson(FILE* out);
+    static void writeProfileCsv(FILE* out);
+
 private:
     chrono::steady_clock::time_point start_time;
     bool isActive = false;